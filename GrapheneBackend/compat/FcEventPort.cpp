@@ -20,13 +20,27 @@
 
 #include <fc/thread/thread.hpp>
 
+void FcEventPort::scheduleKjEvents()
+{
+    scheduledAt = std::chrono::steady_clock::now();
+    fc::async([this]{processKjEvents();});
+}
+
 void FcEventPort::processKjEvents()
 {
-    if (kjLoop)
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    auto start = std::chrono::steady_clock::now();
+    loopMonitor.recordLag(static_cast<uint64_t>(duration_cast<microseconds>(start - scheduledAt).count()));
+
+    if (kjLoop) {
         kjLoop->run();
+        loopMonitor.recordTurn(static_cast<uint64_t>(
+                                   duration_cast<microseconds>(std::chrono::steady_clock::now() - start).count()));
+    }
 
     if (isRunnable)
-        fc::async([this]{processKjEvents();});
+        scheduleKjEvents();
 }
 
 FcEventPort::~FcEventPort()
@@ -48,5 +62,5 @@ void FcEventPort::setRunnable(bool runnable) {
 
     if (runnable)
         // Schedule the kj events to be processed
-        fc::async([this]{processKjEvents();});
+        scheduleKjEvents();
 }
@@ -18,8 +18,12 @@
 #ifndef FCEVENTPORT_HPP
 #define FCEVENTPORT_HPP
 
+#include <LoopMonitor.hpp>
+
 #include <kj/async.h>
 
+#include <chrono>
+
 class FcEventPort : public kj::EventPort
 {
     // Simple EventPort implementation to allow a KJ event loop to run in a thread scheduled by an FC event loop
@@ -28,7 +32,10 @@ class FcEventPort : public kj::EventPort
 
     bool isRunnable = false;
     kj::EventLoop* kjLoop = nullptr;
+    swv::LoopMonitor loopMonitor{"FcEventPort"};
+    std::chrono::steady_clock::time_point scheduledAt;
 
+    void scheduleKjEvents();
     void processKjEvents();
 
 public:
@@ -41,6 +48,11 @@ public:
         this->kjLoop = kjLoop;
     }
 
+    swv::LoopMonitor& monitor() {
+        // Histograms of the runs of the KJ loop and of the lag before each, with alerts when they grow too long
+        return loopMonitor;
+    }
+
     // EventPort interface
     virtual bool wait() override;
     virtual bool poll() override;
@@ -21,29 +21,35 @@
 #include "ContestGeneratorImpl.hpp"
 #include "PurchaseImpl.hpp"
 
+#include <Tracer.hpp>
+#include <ProcessStats.hpp>
+#include <StubCoinDetails.hpp>
+
 #include <kj/debug.h>
 
 #include <unistd.h>
 #include <iostream>
-#include <chrono>
 
 BackendServer::BackendServer()
 {}
 
 ::kj::Promise<void> BackendServer::getContestFeed(GetContestFeedContext context)
 {
+    auto span = swv::Tracer::begin("BackendServer::getContestFeed", context.getParams().getTrace());
     context.getResults().setGenerator(kj::heap<ContestGeneratorImpl>());
     return kj::READY_NOW;
 }
 
 ::kj::Promise<void> BackendServer::searchContests(Backend::Server::SearchContestsContext context)
 {
+    auto span = swv::Tracer::begin("BackendServer::searchContests", context.getParams().getTrace());
     context.getResults().setGenerator(kj::heap<ContestGeneratorImpl>());
     return kj::READY_NOW;
 }
 
 ::kj::Promise<void> BackendServer::getContestResults(Backend::Server::GetContestResultsContext context)
 {
+    auto span = swv::Tracer::begin("BackendServer::getContestResults", context.getParams().getTrace());
     auto contestId = context.getParams().getContestId()[0];
     auto results = context.getResults();
     switch(contestId) {
@@ -62,26 +68,17 @@ BackendServer::BackendServer()
 
 ::kj::Promise<void> BackendServer::getCoinDetails(Backend::Server::GetCoinDetailsContext context)
 {
-    auto results = context.getResults().initDetails();
-    results.setIconUrl("https://followmyvote.com/wp-content/uploads"
-                                                  "/2014/02/Follow-My-Vote-Logo.png");
-    results.setActiveContestCount(15);
-
-    auto historyLength = context.getParams().getVolumeHistoryLength();
-    if (historyLength <= 0)
-        results.getVolumeHistory().setNoHistory();
-    else {
-        auto history = results.getVolumeHistory().initHistory();
-        // Get current time, rewound to the most recent hour
-        history.setHistoryEndTimestamp(
-                    std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::system_clock::now().time_since_epoch()
-                    ).count() / (1000 * 60 * 60) * (1000 * 60 * 60));
-        // TODO: test that this logic for getting the timestamp is correct
-        auto histogram = history.initHistogram(historyLength);
-        for (int i = 0; i < historyLength; ++i)
-            histogram.set(i, 1000000);
-    }
+    swv::populateStubCoinDetails(context.getResults().initDetails(), context.getParams().getVolumeHistoryLength());
+    return kj::READY_NOW;
+}
+
+::kj::Promise<void> BackendServer::getCoinsDetails(Backend::Server::GetCoinsDetailsContext context)
+{
+    auto params = context.getParams();
+    auto span = swv::Tracer::begin("BackendServer::getCoinsDetails", params.getTrace());
+    auto details = context.getResults().initDetails(params.getCoinIds().size());
+    for (auto coinDetails : details)
+        swv::populateStubCoinDetails(coinDetails, params.getVolumeHistoryLength());
     return kj::READY_NOW;
 }
 
@@ -91,6 +88,19 @@ BackendServer::BackendServer()
     return kj::READY_NOW;
 }
 
+::kj::Promise<void> BackendServer::getTraceSpans(Backend::Server::GetTraceSpansContext context)
+{
+    auto records = swv::Tracer::collect();
+    swv::Tracer::fill(context.getResults().initSpans(static_cast<unsigned>(records.size())), records);
+    return kj::READY_NOW;
+}
+
+::kj::Promise<void> BackendServer::getStats(Backend::Server::GetStatsContext context)
+{
+    swv::fillProcessStats(context.getResults().initStats());
+    return kj::READY_NOW;
+}
+
 ::kj::Promise<void> ContestResultsImpl::results(Backend::ContestResults::Server::ResultsContext context)
 {
     auto results = context.getResults().initResults(contestResults.size());
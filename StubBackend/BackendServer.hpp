@@ -40,7 +40,10 @@ protected:
     virtual ::kj::Promise<void> searchContests(SearchContestsContext context);
     virtual ::kj::Promise<void> getContestResults(GetContestResultsContext context);
     virtual ::kj::Promise<void> getCoinDetails(GetCoinDetailsContext context);
+    virtual ::kj::Promise<void> getCoinsDetails(GetCoinsDetailsContext context);
     virtual ::kj::Promise<void> createContest(CreateContestContext context);
+    virtual ::kj::Promise<void> getTraceSpans(GetTraceSpansContext context);
+    virtual ::kj::Promise<void> getStats(GetStatsContext context);
 };
 
 class ContestResultsImpl : public Backend::ContestResults::Server
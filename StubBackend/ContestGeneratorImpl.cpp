@@ -18,6 +18,8 @@
 
 #include "ContestGeneratorImpl.hpp"
 
+#include <Tracer.hpp>
+
 #include <kj/debug.h>
 
 ContestGeneratorImpl::ContestGeneratorImpl()
@@ -36,6 +38,7 @@ ContestGeneratorImpl::~ContestGeneratorImpl()
 
 ::kj::Promise<void> ContestGeneratorImpl::getContests(ContestGenerator::Server::GetContestsContext context)
 {
+    auto span = swv::Tracer::begin("ContestGeneratorImpl::getContests", context.getParams().getTrace());
     auto contestCount = kj::min(context.getParams().getCount(), kj::max(0, 10 - fetched));
     auto contests = context.getResults().initNextContests(static_cast<unsigned>(contestCount));
 
@@ -45,6 +48,14 @@ ContestGeneratorImpl::~ContestGeneratorImpl()
     return kj::READY_NOW;
 }
 
+::kj::Promise<void> ContestGeneratorImpl::skip(ContestGenerator::Server::SkipContext context)
+{
+    auto skipped = kj::min(kj::max(context.getParams().getCount(), int64_t(0)), int64_t(kj::max(0, 10 - fetched)));
+    fetched += static_cast<int>(skipped);
+    context.getResults().setSkipped(skipped);
+    return kj::READY_NOW;
+}
+
 void ContestGeneratorImpl::populateContest(ContestGenerator::ListedContest::Builder contest)
 {
     switch(fetched++) {
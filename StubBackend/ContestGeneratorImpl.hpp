@@ -39,6 +39,7 @@ protected:
         (void)context;
         return kj::READY_NOW;
     }
+    virtual ::kj::Promise<void> skip(SkipContext context);
 
 private:
     void populateContest(ContestGenerator::ListedContest::Builder contest);
@@ -20,11 +20,8 @@
 #include "ContestResults.hpp"
 #include "ContestCreator.hpp"
 
-#include "decision.capnp.h"
-
-#include <capnp/serialize.h>
-
-#include <chrono>
+#include <ProcessStats.hpp>
+#include <StubCoinDetails.hpp>
 
 namespace swv {
 
@@ -77,62 +74,15 @@ StubChainAdaptor::BackendStub::~BackendStub()
 
 ::kj::Promise<void> StubChainAdaptor::BackendStub::getContestResults(Backend::Server::GetContestResultsContext context) {
     auto contestId = context.getParams().getContestId();
-    auto contest = adaptor.getContest(contestId).getContest();
-    std::map<int32_t, int64_t> contestantTallies;
-    std::map<kj::String, int64_t> writeInTallies;
+    // Throws if the contest doesn't exist
+    adaptor.getContest(contestId);
 
-    for (const auto& datagramPair : adaptor.datagrams) {
-        auto datagram = datagramPair.second.getReader();
-        // If this is a decision on the contest we're tallying...
-        if (datagram.getIndex().getType() == Datagram::DatagramType::DECISION &&
-                datagram.getIndex().getKey() == contestId) {
-            // Read the decsision out of the datagram
-            kj::ArrayInputStream datagramStream(datagram.getContent());
-            capnp::InputStreamMessageReader message(datagramStream);
-            auto decision = message.getRoot<Decision>();
-
-            if (decision.getContest() != contestId) {
-                KJ_LOG(WARNING,
-                       "Datagram claiming to be relevant to one contest contains a decision for a different contest",
-                       contestId, decision.getContest());
-                continue;
-            }
-            if (decision.getOpinions().size() != 1) {
-                KJ_LOG(WARNING, "Decision does not have exactly one opinion. This is currently unsupported",
-                       decision);
-                continue;
-            }
-
-            auto contestant = decision.getOpinions()[0].getContestant();
-            if (contestant < 0 ||
-                    contestant >= contest.getContestants().getEntries().size() +
-                    decision.getWriteIns().getEntries().size()) {
-                KJ_LOG(WARNING, "Decision specifies a contestant which does not exist", decision, contest);
-                continue;
-            }
-
-            KJ_IF_MAYBE(balancePointer, adaptor.getBalanceOrphan(std::get<0>(datagramPair.first))) {
-                auto balance = balancePointer->getReader();
-
-                if (balance.getType() != contest.getCoin()) {
-                    KJ_LOG(WARNING, "Decision is published on balance which has a different coin than contest",
-                           decision, balance);
-                    continue;
-                }
-                if (contestant < contest.getContestants().getEntries().size())
-                    contestantTallies[contestant] += balance.getAmount();
-                else {
-                    contestant -= contest.getContestants().getEntries().size();
-                    auto contestantName = kj::heapString(decision.getWriteIns().getEntries()[contestant].getKey());
-                    writeInTallies[kj::mv(contestantName)] += balance.getAmount();
-                }
-            } else {
-                KJ_LOG(WARNING, "Unable to find balance for decision",
-                       decision, std::get<0>(datagramPair.first).toHex().toStdString());
-                continue;
-            }
-        }
-    }
+    // The tally is kept current as decisions are published and balances change, so there's nothing to count here
+    const auto& tally = adaptor.getTally(contestId);
+    std::map<int32_t, int64_t> contestantTallies = tally.contestants;
+    std::map<kj::String, int64_t> writeInTallies;
+    for (const auto& writeIn : tally.writeIns)
+        writeInTallies.emplace(kj::heapString(writeIn.first), writeIn.second);
 
     context.initResults().setResults(kj::heap<ContestResults>(kj::mv(contestantTallies), kj::mv(writeInTallies)));
     return kj::READY_NOW;
@@ -144,27 +94,22 @@ StubChainAdaptor::BackendStub::~BackendStub()
 }
 
 ::kj::Promise<void> StubChainAdaptor::BackendStub::getCoinDetails(Backend::Server::GetCoinDetailsContext context) {
-    auto results = context.getResults().initDetails();
-    results.setIconUrl("https://followmyvote.com/wp-content/uploads"
-                                                  "/2014/02/Follow-My-Vote-Logo.png");
-    results.setActiveContestCount(15);
-
-    auto historyLength = context.getParams().getVolumeHistoryLength();
-    if (historyLength <= 0)
-        results.getVolumeHistory().setNoHistory();
-    else {
-        auto history = results.getVolumeHistory().initHistory();
-        // Get current time, rewound to the most recent hour
-        history.setHistoryEndTimestamp(
-                    std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::system_clock::now().time_since_epoch()
-                    ).count() / (1000 * 60 * 60) * (1000 * 60 * 60));
-        // TODO: test that this logic for getting the timestamp is correct
-        KJ_LOG(DBG, history.getHistoryEndTimestamp());
-        auto histogram = history.initHistogram(historyLength);
-        for (int i = 0; i < historyLength; ++i)
-            histogram.set(i, 1000000);
-    }
+    swv::populateStubCoinDetails(context.getResults().initDetails(), context.getParams().getVolumeHistoryLength());
+    return kj::READY_NOW;
+}
+
+::kj::Promise<void> StubChainAdaptor::BackendStub::getCoinsDetails(Backend::Server::GetCoinsDetailsContext context) {
+    auto params = context.getParams();
+    auto details = context.getResults().initDetails(params.getCoinIds().size());
+    for (auto coinDetails : details)
+        swv::populateStubCoinDetails(coinDetails, params.getVolumeHistoryLength());
+    return kj::READY_NOW;
+}
+
+::kj::Promise<void> StubChainAdaptor::BackendStub::getStats(Backend::Server::GetStatsContext context) {
+    // The stub runs in the client's process and shares its registries through the shared library, so this reports the
+    // client's arenas and loop, the adaptor's among them
+    fillProcessStats(context.getResults().initStats());
     return kj::READY_NOW;
 }
 
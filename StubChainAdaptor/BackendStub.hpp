@@ -39,7 +39,9 @@ protected:
     ::kj::Promise<void> searchContests(SearchContestsContext context);
     ::kj::Promise<void> getContestResults(GetContestResultsContext context);
     ::kj::Promise<void> getCoinDetails(GetCoinDetailsContext context);
+    ::kj::Promise<void> getCoinsDetails(GetCoinsDetailsContext context);
     ::kj::Promise<void> createContest(CreateContestContext context);
+    ::kj::Promise<void> getStats(GetStatsContext context);
 
 private:
     StubChainAdaptor& adaptor;
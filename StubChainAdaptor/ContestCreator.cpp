@@ -169,6 +169,7 @@ StubChainAdaptor::ContestCreator::~ContestCreator()
         contest.setCoin(weightCoin);
         contest.setStartTime(now);
         contest.setEndTime(endTime);
+        adaptor.resolveDecisions(contest.asReader().getId());
         KJ_LOG(DBG, "Created contest", contest);
     }, kj::mv(surcharges)));
 
@@ -19,6 +19,8 @@
 
 #include <kj/debug.h>
 
+#include <algorithm>
+
 swv::ContestGenerator::ContestGenerator(std::vector<Contest::Reader> contests)
     : contests(kj::mv(contests))
 {}
@@ -50,6 +52,14 @@ swv::ContestGenerator::~ContestGenerator()
     return kj::READY_NOW;
 }
 
+::kj::Promise<void> swv::ContestGenerator::skip(ContestGenerator::Server::SkipContext context)
+{
+    auto skipped = std::min<int64_t>(contests.size(), std::max<int64_t>(context.getParams().getCount(), 0));
+    contests.resize(contests.size() - static_cast<size_t>(skipped));
+    context.getResults().setSkipped(skipped);
+    return kj::READY_NOW;
+}
+
 ::kj::Promise<void> swv::ContestGenerator::logEngagement(ContestGenerator::Server::LogEngagementContext)
 {
     // Currently a nop
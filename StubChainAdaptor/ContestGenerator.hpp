@@ -38,6 +38,7 @@ protected:
     ::kj::Promise<void> getContest(GetContestContext context);
     ::kj::Promise<void> getContests(GetContestsContext context);
     ::kj::Promise<void> logEngagement(LogEngagementContext);
+    ::kj::Promise<void> skip(SkipContext context);
 
 private:
     std::vector<Contest::Reader> contests;
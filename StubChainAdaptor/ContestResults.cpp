@@ -48,7 +48,8 @@ ContestResults::~ContestResults()
 
 ::kj::Promise<void> swv::ContestResults::subscribe(Backend::ContestResults::Server::SubscribeContext context)
 {
-    // TODO
+    // For now, results never update in the stub.
+    return kj::READY_NOW;
 }
 
 } // namespace swv
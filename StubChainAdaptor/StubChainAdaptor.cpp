@@ -16,21 +16,53 @@
  * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "BackendStub.hpp"
+#include "decision.capnp.h"
 
 #include <capnp/dynamic.h>
+#include <capnp/serialize.h>
 
 #include <QDebug>
+#include <QCryptographicHash>
 #include <QDateTime>
+#include <QHash>
 
+#include <algorithm>
 #include <functional>
 
 #include <kj/debug.h>
 
 namespace swv {
 
+/// Encode a counter as an ID: its big-endian bytes without leading zeros, so the first 256 IDs are a single byte
+static QByteArray counterId(quint64 counter) {
+    QByteArray id;
+    do {
+        id.prepend(static_cast<char>(counter & 0xff));
+        counter >>= 8;
+    } while (counter);
+    return id;
+}
+
 StubChainAdaptor::StubChainAdaptor(QObject* parent)
-    : QObject(parent)
+    : QObject(parent),
+      message("StubChainAdaptor")
 {
+    message.setReachableWords([this]() -> uint64_t {
+        uint64_t words = 0;
+        for (const auto& coin : coins)
+            words += coin.getReader().totalSize().wordCount;
+        for (const auto& contest : contests)
+            words += contest.getReader().totalSize().wordCount;
+        for (const auto& ownerBalances : balances)
+            for (const auto& balance : ownerBalances.second)
+                words += balance.getReader().totalSize().wordCount;
+        for (const auto& payload : datagramPayloads)
+            words += payload.second.datagram.getReader().totalSize().wordCount;
+        KJ_IF_MAYBE(datagram, pendingDatagram)
+            words += datagram->getReader().totalSize().wordCount;
+        return words;
+    });
+
     auto coin = createCoin();
     coin.setName("BTS");
     coin.setPrecision(5);
@@ -170,11 +202,16 @@ kj::Promise<kj::Array<Balance::Reader>> StubChainAdaptor::getBalancesForOwner(QS
 }
 
 Contest::Reader StubChainAdaptor::getContest(capnp::Data::Reader contestId) const
+{
+    return KJ_REQUIRE_NONNULL(findContest(contestId), "Could not find the specified contest", contestId);
+}
+
+kj::Maybe<Contest::Reader> StubChainAdaptor::findContest(capnp::Data::Reader contestId) const
 {
     for (auto& contest : contests)
         if (contest.getReader().getContest().getId() == contestId)
             return contest.getReader();
-    KJ_FAIL_REQUIRE("Could not find the specified contest", contestId);
+    return nullptr;
 }
 
 Datagram::Builder StubChainAdaptor::createDatagram()
@@ -189,19 +226,51 @@ Datagram::Builder StubChainAdaptor::createDatagram()
 
 kj::Promise<Contest::Reader> StubChainAdaptor::getContest(QByteArray contestId) const
 {
-    for (auto& contest : contests)
-        if (*contest.getReader().getContest().getId().begin() == *contestId.begin())
+    for (auto& contest : contests) {
+        auto id = contest.getReader().getContest().getId();
+        if (QByteArray::fromRawData(reinterpret_cast<const char*>(id.begin()), static_cast<int>(id.size())) == contestId)
             return contest.getReader();
+    }
     return KJ_EXCEPTION(FAILED, "Could not find the specified contest", contestId.toHex().toStdString());
 }
 
+kj::Promise<kj::Array<kj::Maybe<Contest::Reader>>> StubChainAdaptor::getContests(kj::Array<QByteArray> contestIds) const
+{
+    // Index the requested IDs, then make a single pass over the contests to find them all
+    QMultiHash<QByteArray, size_t> positions;
+    for (size_t i = 0; i < contestIds.size(); ++i)
+        positions.insert(contestIds[i], i);
+
+    auto results = kj::heapArray<kj::Maybe<Contest::Reader>>(contestIds.size());
+    for (auto& contest : contests) {
+        auto reader = contest.getReader();
+        auto id = reader.getContest().getId();
+        auto key = QByteArray::fromRawData(reinterpret_cast<const char*>(id.begin()), id.size());
+        for (auto itr = positions.find(key); itr != positions.end() && itr.key() == key; ++itr)
+            results[itr.value()] = reader;
+    }
+
+    return kj::mv(results);
+}
+
 kj::Promise<void> StubChainAdaptor::publishDatagram(QByteArray payerBalanceId, QByteArray publisherBalanceId)
 {
     capnp::Orphan<Datagram> dgram = kj::mv(KJ_REQUIRE_NONNULL(pendingDatagram,
                                                               "No datagram exists to be published. "
                                                               "Call createDatagram first!"));
     pendingDatagram = nullptr;
+    return storeDatagram(kj::mv(dgram), payerBalanceId, publisherBalanceId);
+}
+
+kj::Promise<void> StubChainAdaptor::publishDatagram(QByteArray payerBalanceId, QByteArray publisherBalanceId,
+                                                    Datagram::Reader datagram)
+{
+    return storeDatagram(message.getOrphanage().newOrphanCopy(datagram), payerBalanceId, publisherBalanceId);
+}
 
+kj::Promise<void> StubChainAdaptor::storeDatagram(capnp::Orphan<Datagram> dgram, QByteArray payerBalanceId,
+                                                  QByteArray publisherBalanceId)
+{
     auto maybePayerBalance = getBalanceOrphan(payerBalanceId);
     auto maybePublisherBalance = getBalanceOrphan(publisherBalanceId);
     KJ_IF_MAYBE(payerBalance, maybePayerBalance) {
@@ -210,11 +279,37 @@ kj::Promise<void> StubChainAdaptor::publishDatagram(QByteArray payerBalanceId, Q
             Balance::Builder builder = payerBalance->get();
             KJ_REQUIRE(builder.getAmount() >= 10, "The specified balance cannot pay the fee");
             builder.setAmount(builder.getAmount() - 10);
+            adjustTallies(payerBalanceId, builder.getType(), -10);
+
+            auto content = dgram.getReader().getContent();
+            auto hash = QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char*>(content.begin()),
+                                                                         static_cast<int>(content.size())),
+                                                 QCryptographicHash::Sha256);
+            dgram.get().setContentHash(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(hash.constData()),
+                                                           static_cast<size_t>(hash.size())));
 
             auto index = dgram.getReader().getIndex();
             KJ_LOG(DBG, "Publishing datagram.", publisherBalanceId.toHex().toStdString(), static_cast<uint16_t>(index.getType()), index.getKey());
-            std::vector<kj::byte> key(index.getKey().begin(), index.getKey().end());
-            datagrams[std::make_tuple(publisherBalanceId, index.getType(), kj::mv(key))] = kj::mv(dgram);
+            DatagramKey datagramKey(publisherBalanceId, index.getType(),
+                                    std::vector<kj::byte>(index.getKey().begin(), index.getKey().end()));
+            // If the same datagram is already stored, this copy is dropped and the stored one referenced instead
+            auto payload = payloadKey(datagramKey, hash);
+            if (datagramPayloads.find(payload) == datagramPayloads.end()) {
+                DatagramPayload newPayload{kj::mv(dgram), {}};
+                if (index.getType() == Datagram::DatagramType::DECISION) {
+                    KJ_IF_MAYBE(contest, findContest(index.getKey())) {
+                        newPayload.vote = readVote(newPayload.datagram.getReader(), *contest);
+                        newPayload.coin = contest->getContest().getCoin();
+                        if (newPayload.vote == nullptr)
+                            KJ_LOG(WARNING, "Decision will not be counted, as it is not a valid decision on the "
+                                            "contest it is published on", index.getKey());
+                    } else {
+                        KJ_LOG(WARNING, "Decision will not be counted until its contest is created", index.getKey());
+                    }
+                }
+                datagramPayloads.emplace(kj::mv(payload), kj::mv(newPayload));
+            }
+            referencePayload(kj::mv(datagramKey), kj::mv(hash));
             return kj::READY_NOW;
         } else {
             KJ_FAIL_REQUIRE("Could not find the publisher balance");
@@ -241,23 +336,31 @@ kj::Promise<void> StubChainAdaptor::transfer(QString sender, QString recipient,
         KJ_REQUIRE(senderFunds >= amount, "Cannot transfer because sender has insufficient funds", senderFunds, amount);
 
         auto amountRemaining = amount;
-        for (auto balance = senderBalances->second.begin(); balance != senderBalances->second.end(); ++balance)
-            if (balance->getReader().getType() == coinId) {
-                if (balance->getReader().getAmount() <= amountRemaining) {
-                    amountRemaining -= balance->getReader().getAmount();
-                    balance = senderBalances->second.erase(balance);
-                    if (amountRemaining == 0)
-                        break;
-                } else {
-                    balance->get().setAmount(balance->get().getAmount() - amountRemaining);
-                    amountRemaining = 0;
-                    break;
-                }
+        auto balance = senderBalances->second.begin();
+        while (amountRemaining > 0 && balance != senderBalances->second.end()) {
+            auto reader = balance->getReader();
+            if (reader.getType() != coinId) {
+                ++balance;
+                continue;
+            }
+
+            auto id = reader.getId();
+            QByteArray balanceId(reinterpret_cast<const char*>(id.begin()), static_cast<int>(id.size()));
+            if (reader.getAmount() <= amountRemaining) {
+                amountRemaining -= reader.getAmount();
+                adjustTallies(balanceId, coinId, -reader.getAmount());
+                balanceOwners.remove(balanceId);
+                balance = senderBalances->second.erase(balance);
+            } else {
+                balance->get().setAmount(reader.getAmount() - amountRemaining);
+                adjustTallies(balanceId, coinId, -amountRemaining);
+                amountRemaining = 0;
             }
+        }
 
         auto newBalance = createBalance(recipient);
         newBalance.setType(coinId);
-        newBalance.setAmount(amountRemaining);
+        newBalance.setAmount(amount);
 
         return kj::READY_NOW;
     } catch (kj::Exception& e) {
@@ -265,47 +368,251 @@ kj::Promise<void> StubChainAdaptor::transfer(QString sender, QString recipient,
     }
 }
 
+kj::Promise<Balance::Reader> StubChainAdaptor::consolidateBalances(QString owner, quint64 coinId)
+{
+    KJ_LOG(DBG, "Attempting to consolidate balances", owner.toStdString(), coinId);
+
+    auto ownerBalances = balances.find(owner);
+    if (ownerBalances == balances.end())
+        return KJ_EXCEPTION(FAILED, "Cannot consolidate because owner has no balances", owner.toStdString());
+
+    // Gather the balances in the coin at the end, still in creation order
+    auto& ownerList = ownerBalances->second;
+    auto inCoin = std::stable_partition(ownerList.begin(), ownerList.end(),
+                                        [coinId](const capnp::Orphan<Balance>& balance) {
+        return balance.getReader().getType() != coinId;
+    });
+    if (inCoin == ownerList.end())
+        return KJ_EXCEPTION(FAILED, "Cannot consolidate because owner has no balances in the coin",
+                            owner.toStdString(), coinId);
+    if (ownerList.end() - inCoin == 1)
+        return inCoin->getReader();
+
+    qint64 amount = 0;
+    std::vector<QByteArray> mergedIds;
+    for (auto balance = inCoin; balance != ownerList.end(); ++balance) {
+        auto id = balance->getReader().getId();
+        amount += balance->getReader().getAmount();
+        mergedIds.emplace_back(reinterpret_cast<const char*>(id.begin()), static_cast<int>(id.size()));
+        // The balance's weight moves to the new balance along with its datagrams
+        adjustTallies(mergedIds.back(), coinId, -balance->getReader().getAmount());
+    }
+    ownerList.erase(inCoin, ownerList.end());
+    for (const auto& id : mergedIds)
+        balanceOwners.remove(id);
+
+    auto newBalance = createBalance(owner);
+    newBalance.setType(coinId);
+    newBalance.setAmount(amount);
+    auto newId = newBalance.asReader().getId();
+    QByteArray newBalanceId(reinterpret_cast<const char*>(newId.begin()), static_cast<int>(newId.size()));
+
+    // Move the datagrams over oldest balance first, so that the newest balance's datagram wins any conflict
+    for (const auto& id : mergedIds) {
+        auto datagram = datagrams.lower_bound(std::make_tuple(id, Datagram::DatagramType(), std::vector<kj::byte>()));
+        while (datagram != datagrams.end() && std::get<0>(datagram->first) == id) {
+            referencePayload(DatagramKey(newBalanceId, std::get<1>(datagram->first), std::get<2>(datagram->first)),
+                             datagram->second);
+            releasePayload(datagram->first, datagram->second);
+            datagram = datagrams.erase(datagram);
+        }
+    }
+
+    KJ_LOG(DBG, "Consolidated balances", mergedIds.size(), amount);
+    return newBalance.asReader();
+}
+
 kj::Promise<Datagram::Reader> StubChainAdaptor::getDatagram(QByteArray balanceId,
                                                             Datagram::DatagramType type,
-                                                            QString key) const
+                                                            QByteArray key) const
 {
-    auto binaryKey = QByteArray::fromHex(key.toLocal8Bit());
-    std::vector<kj::byte> keyVector(binaryKey.begin(), binaryKey.end());
+    std::vector<kj::byte> keyVector(key.begin(), key.end());
     auto itr = datagrams.find(std::make_tuple(balanceId, type, kj::mv(keyVector)));
     if (itr == datagrams.end())
         return KJ_EXCEPTION(FAILED, "No datagram belonging to the specified balance "
                                     "with the specified type and key found.",
-                            balanceId.toHex().data(), static_cast<uint16_t>(type), key.toStdString());
-    return itr->second.getReader();
+                            balanceId.toHex().data(), static_cast<uint16_t>(type), key.toHex().data());
+    return datagramPayloads.at(payloadKey(itr->first, itr->second)).datagram.getReader();
 }
 
-kj::Maybe<capnp::Orphan<Balance>&> StubChainAdaptor::getBalanceOrphan(QByteArray id)
+kj::Promise<kj::Array<kj::Maybe<Datagram::Reader>>> StubChainAdaptor::getDatagrams(kj::Array<QByteArray> balanceIds,
+                                                                                   Datagram::DatagramType type,
+                                                                                   QByteArray key) const
 {
-    for (auto& bals : balances)
-    {
-        auto itr = std::find_if(bals.second.begin(), bals.second.end(), [id](const capnp::Orphan<Balance>& balance) {
-            auto data = balance.getReader().getId();
-            QByteArray otherId(reinterpret_cast<const char*>(data.begin()), static_cast<int>(data.size()));
-            return otherId == id;
-        });
-        if (itr != bals.second.end())
-            return *itr;
+    auto tuple = std::make_tuple(QByteArray(), type, std::vector<kj::byte>(key.begin(), key.end()));
+    return KJ_MAP(balanceId, balanceIds) -> kj::Maybe<Datagram::Reader> {
+        std::get<0>(tuple) = balanceId;
+        auto itr = datagrams.find(tuple);
+        if (itr == datagrams.end())
+            return nullptr;
+        return datagramPayloads.at(payloadKey(itr->first, itr->second)).datagram.getReader();
+    };
+}
+
+StubChainAdaptor::PayloadKey StubChainAdaptor::payloadKey(const DatagramKey& datagram, QByteArray contentHash)
+{
+    return PayloadKey(std::get<1>(datagram), std::get<2>(datagram), kj::mv(contentHash));
+}
+
+void StubChainAdaptor::referencePayload(DatagramKey datagram, QByteArray contentHash)
+{
+    // Take the new reference before dropping the old one, in case they're the same payload
+    auto key = payloadKey(datagram, contentHash);
+    auto& payload = datagramPayloads.at(key);
+    if (payload.balanceIds.insert(std::get<0>(datagram)).second)
+        addToTally(key, payload, payloadWeight(std::get<0>(datagram), payload));
+    auto existing = datagrams.find(datagram);
+    if (existing == datagrams.end()) {
+        datagrams.emplace(kj::mv(datagram), kj::mv(contentHash));
+    } else if (existing->second != contentHash) {
+        releasePayload(existing->first, existing->second);
+        existing->second = kj::mv(contentHash);
     }
+}
+
+void StubChainAdaptor::releasePayload(const DatagramKey& datagram, QByteArray contentHash)
+{
+    auto payload = datagramPayloads.find(payloadKey(datagram, kj::mv(contentHash)));
+    KJ_ASSERT(payload != datagramPayloads.end(), "Datagram references a payload which is not stored");
+    if (payload->second.balanceIds.erase(std::get<0>(datagram)))
+        addToTally(payload->first, payload->second, -payloadWeight(std::get<0>(datagram), payload->second));
+    if (payload->second.balanceIds.empty())
+        datagramPayloads.erase(payload);
+}
+
+kj::Maybe<StubChainAdaptor::Vote> StubChainAdaptor::readVote(Datagram::Reader datagram, Contest::Reader contest)
+{
+    kj::ArrayInputStream datagramStream(datagram.getContent());
+    capnp::InputStreamMessageReader message(datagramStream);
+    auto decision = message.getRoot<Decision>();
+    auto contestants = contest.getContest().getContestants().getEntries();
+
+    if (decision.getContest() != contest.getContest().getId() || decision.getOpinions().size() != 1)
+        return nullptr;
+    auto contestant = decision.getOpinions()[0].getContestant();
+    if (contestant < 0 || contestant >= contestants.size() + decision.getWriteIns().getEntries().size())
+        return nullptr;
+
+    if (contestant < contestants.size())
+        return Vote{contestant, nullptr};
+    auto writeIn = decision.getWriteIns().getEntries()[contestant - contestants.size()].getKey();
+    return Vote{contestant, kj::heapString(writeIn)};
+}
+
+qint64 StubChainAdaptor::payloadWeight(QByteArray balanceId, const DatagramPayload& payload) const
+{
+    KJ_IF_MAYBE(balance, getBalanceOrphan(balanceId)) {
+        auto reader = balance->getReader();
+        if (reader.getType() == payload.coin)
+            return reader.getAmount();
+    }
+    return 0;
+}
+
+void StubChainAdaptor::addToTally(const PayloadKey& key, const DatagramPayload& payload, qint64 weight)
+{
+    if (weight == 0)
+        return;
+    KJ_IF_MAYBE(vote, payload.vote) {
+        auto& tally = tallies[std::get<1>(key)];
+        KJ_IF_MAYBE(writeIn, vote->writeIn) {
+            auto entry = tally.writeIns.find(*writeIn);
+            if (entry == tally.writeIns.end())
+                entry = tally.writeIns.emplace(kj::heapString(*writeIn), 0).first;
+            if ((entry->second += weight) == 0)
+                tally.writeIns.erase(entry);
+        } else {
+            if ((tally.contestants[vote->contestant] += weight) == 0)
+                tally.contestants.erase(vote->contestant);
+        }
+        if (tally.contestants.empty() && tally.writeIns.empty())
+            tallies.erase(std::get<1>(key));
+    }
+}
+
+void StubChainAdaptor::adjustTallies(QByteArray balanceId, quint64 coinId, qint64 amountChange)
+{
+    for (auto datagram = datagrams.lower_bound(DatagramKey(balanceId, Datagram::DatagramType(), {}));
+         datagram != datagrams.end() && std::get<0>(datagram->first) == balanceId; ++datagram) {
+        auto key = payloadKey(datagram->first, datagram->second);
+        const auto& payload = datagramPayloads.at(key);
+        if (payload.coin == coinId)
+            addToTally(key, payload, amountChange);
+    }
+}
+
+const StubChainAdaptor::ContestTally& StubChainAdaptor::getTally(capnp::Data::Reader contestId) const
+{
+    static const ContestTally EMPTY_TALLY;
+    auto tally = tallies.find(std::vector<kj::byte>(contestId.begin(), contestId.end()));
+    if (tally == tallies.end())
+        return EMPTY_TALLY;
+    return tally->second;
+}
+
+StubChainAdaptor::ContestTally StubChainAdaptor::recountTally(capnp::Data::Reader contestId) const
+{
+    auto contest = getContest(contestId);
+    ContestTally tally;
+
+    // Deliberately shares nothing with the incremental bookkeeping but readVote: every datagram is decoded afresh, and
+    // weighed by the balance it's on
+    for (const auto& datagram : datagrams) {
+        if (std::get<1>(datagram.first) != Datagram::DatagramType::DECISION ||
+                !std::equal(contestId.begin(), contestId.end(),
+                            std::get<2>(datagram.first).begin(), std::get<2>(datagram.first).end()))
+            continue;
+
+        auto reader = datagramPayloads.at(payloadKey(datagram.first, datagram.second)).datagram.getReader();
+        auto maybeVote = readVote(reader, contest);
+        KJ_IF_MAYBE(vote, maybeVote) {
+            KJ_IF_MAYBE(balance, getBalanceOrphan(std::get<0>(datagram.first))) {
+                auto weight = balance->getReader().getAmount();
+                if (balance->getReader().getType() != contest.getContest().getCoin() || weight == 0)
+                    continue;
+                KJ_IF_MAYBE(writeIn, vote->writeIn) {
+                    auto entry = tally.writeIns.find(*writeIn);
+                    if (entry == tally.writeIns.end())
+                        tally.writeIns.emplace(kj::mv(*writeIn), weight);
+                    else
+                        entry->second += weight;
+                } else {
+                    tally.contestants[vote->contestant] += weight;
+                }
+            }
+        }
+    }
+
+    return tally;
+}
+
+kj::Maybe<capnp::Orphan<Balance>&> StubChainAdaptor::getBalanceOrphan(QByteArray id)
+{
+    auto owner = balanceOwners.find(id);
+    if (owner == balanceOwners.end())
+        return {};
+    auto& bals = balances.at(owner.value());
+    auto itr = std::find_if(bals.begin(), bals.end(), [id](const capnp::Orphan<Balance>& balance) {
+        auto data = balance.getReader().getId();
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(data.begin()), static_cast<int>(data.size())) == id;
+    });
+    if (itr != bals.end())
+        return *itr;
     return {};
 }
 
 kj::Maybe<const capnp::Orphan<Balance>&> StubChainAdaptor::getBalanceOrphan(QByteArray id) const
 {
-    for (const auto& bals : balances)
-    {
-        auto itr = std::find_if(bals.second.begin(), bals.second.end(), [id](const capnp::Orphan<Balance>& balance) {
-            auto data = balance.getReader().getId();
-            QByteArray otherId(reinterpret_cast<const char*>(data.begin()), static_cast<int>(data.size()));
-            return otherId == id;
-        });
-        if (itr != bals.second.end())
-            return *itr;
-    }
+    auto owner = balanceOwners.constFind(id);
+    if (owner == balanceOwners.constEnd())
+        return {};
+    const auto& bals = balances.at(owner.value());
+    auto itr = std::find_if(bals.begin(), bals.end(), [id](const capnp::Orphan<Balance>& balance) {
+        auto data = balance.getReader().getId();
+        return QByteArray::fromRawData(reinterpret_cast<const char*>(data.begin()), static_cast<int>(data.size())) == id;
+    });
+    if (itr != bals.end())
+        return *itr;
     return {};
 }
 
@@ -332,15 +639,37 @@ kj::Maybe<const capnp::Orphan<Coin>&> StubChainAdaptor::getCoinOrphan(QString na
 Contest::Builder StubChainAdaptor::createContest()
 {
     auto newContest = contests.emplace(contests.begin(), message.getOrphanage().newOrphan<::Contest>())->get();
-    newContest.initContest().initId(1)[0] = contests.size() - 1;
+    auto id = counterId(contests.size() - 1);
+    newContest.initContest().setId(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(id.constData()),
+                                                       static_cast<size_t>(id.size())));
     return newContest;
 }
 
+void StubChainAdaptor::resolveDecisions(capnp::Data::Reader contestId)
+{
+    auto contest = getContest(contestId);
+    std::vector<kj::byte> key(contestId.begin(), contestId.end());
+    for (auto payload = datagramPayloads.lower_bound(PayloadKey(Datagram::DatagramType::DECISION, key, {}));
+         payload != datagramPayloads.end() && std::get<0>(payload->first) == Datagram::DatagramType::DECISION &&
+         std::get<1>(payload->first) == key; ++payload) {
+        // Decisions read against the contest before are already counted, or will never be
+        if (payload->second.vote != nullptr)
+            continue;
+        payload->second.vote = readVote(payload->second.datagram.getReader(), contest);
+        payload->second.coin = contest.getContest().getCoin();
+        for (const auto& balanceId : payload->second.balanceIds)
+            addToTally(payload->first, payload->second, payloadWeight(balanceId, payload->second));
+    }
+}
+
 Balance::Builder StubChainAdaptor::createBalance(QString owner)
 {
     balances[owner].emplace_back(message.getOrphanage().newOrphan<::Balance>());
     auto& newBalance = balances[owner].back();
-    newBalance.get().initId(1)[0] = nextBalanceId++;
+    auto id = counterId(nextBalanceId++);
+    balanceOwners.insert(id, owner);
+    newBalance.get().setId(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(id.constData()),
+                                               static_cast<size_t>(id.size())));
     return newBalance.get();
 }
 
@@ -21,16 +21,20 @@
 #include "capnp/backend.capnp.h"
 
 #include <QObject>
+#include <QHash>
 #include <QMap>
 
 #include <capnp/message.h>
 
 #include <kj/async.h>
 
+#include <map>
+#include <set>
 #include <vector>
 
 #include "StubChainAdaptor_global.hpp"
 #include "BlockchainAdaptorInterface.hpp"
+#include "TrackingMessageBuilder.hpp"
 
 namespace swv {
 
@@ -42,6 +46,19 @@ public:
     class BackendStub;
     class ContestCreator;
 
+    /// Stake-weighted tally of the decisions on a contest. Contestants and write-ins with no weight are left out.
+    struct ContestTally {
+        std::map<int32_t, int64_t> contestants;
+        std::map<kj::String, int64_t> writeIns;
+
+        bool operator==(const ContestTally& other) const {
+            return contestants == other.contestants && writeIns == other.writeIns;
+        }
+        bool operator!=(const ContestTally& other) const {
+            return !(*this == other);
+        }
+    };
+
     StubChainAdaptor(QObject* parent = nullptr);
     virtual ~StubChainAdaptor() noexcept;
 
@@ -55,29 +72,79 @@ public:
     virtual kj::Promise<kj::Array<Balance::Reader>> getBalancesForOwner(QString owner) const;
     virtual kj::Promise<::Contest::Reader> getContest(QByteArray contestId) const;
     ::Contest::Reader getContest(capnp::Data::Reader contestId) const;
+    kj::Maybe<::Contest::Reader> findContest(capnp::Data::Reader contestId) const;
+    virtual kj::Promise<kj::Array<kj::Maybe<::Contest::Reader>>> getContests(kj::Array<QByteArray> contestIds) const;
 
     virtual ::Datagram::Builder createDatagram();
     virtual kj::Promise<void> publishDatagram(QByteArray payerBalanceId, QByteArray publisherBalanceId);
+    virtual kj::Promise<void> publishDatagram(QByteArray payerBalanceId, QByteArray publisherBalanceId,
+                                              Datagram::Reader datagram);
     virtual kj::Promise<::Datagram::Reader> getDatagram(QByteArray balanceId,
                                                         Datagram::DatagramType type,
-                                                        QString key) const;
+                                                        QByteArray key) const;
+    virtual kj::Promise<kj::Array<kj::Maybe<::Datagram::Reader>>> getDatagrams(kj::Array<QByteArray> balanceIds,
+                                                                              Datagram::DatagramType type,
+                                                                              QByteArray key) const;
 
     kj::Promise<void> transfer(QString sender, QString recipient, qint64 amount, quint64 coinId);
+    virtual kj::Promise<Balance::Reader> consolidateBalances(QString owner, quint64 coinId);
+
+    /// Get the tally of a contest. It is kept up to date as decisions are published and balances change.
+    const ContestTally& getTally(capnp::Data::Reader contestId) const;
+    /// Count the decisions on a contest from scratch. This is slow, and exists to check @ref getTally against.
+    ContestTally recountTally(capnp::Data::Reader contestId) const;
 
 protected:
-    capnp::MallocMessageBuilder message;
+    // All of the chain's data is kept in orphans in this message; nothing is set as its root
+    TrackingMessageBuilder message;
     std::vector<capnp::Orphan<Coin>> coins;
     std::vector<capnp::Orphan<Contest>> contests;
     std::map<QString, std::vector<capnp::Orphan<Balance>>> balances;
-    std::map<std::tuple<QByteArray, Datagram::DatagramType, std::vector<kj::byte>>, capnp::Orphan<::Datagram>> datagrams;
+    // Owner of each balance by ID, so a balance is found without searching every owner's balances
+    QHash<QByteArray, QString> balanceOwners;
+    /// Balance ID, type and key of a datagram published on a balance
+    using DatagramKey = std::tuple<QByteArray, Datagram::DatagramType, std::vector<kj::byte>>;
+    /// Type, key and content hash of a stored datagram
+    using PayloadKey = std::tuple<Datagram::DatagramType, std::vector<kj::byte>, QByteArray>;
+    /// What a decision counts toward: a listed contestant by index, or a write-in by name
+    struct Vote {
+        int32_t contestant;
+        kj::Maybe<kj::String> writeIn;
+    };
+    struct DatagramPayload {
+        capnp::Orphan<::Datagram> datagram;
+        /// IDs of the balances this datagram is published on
+        std::set<QByteArray> balanceIds;
+        /// If this is a valid decision, what it counts toward and the coin of its contest. A decision published before
+        /// its contest is created is left uncounted until @ref resolveDecisions reads it against the new contest.
+        kj::Maybe<Vote> vote;
+        quint64 coin = 0;
+    };
+    // Each distinct datagram is stored once in datagramPayloads, however many balances it's published on. The
+    // datagrams map gives the content hash of the datagram published on each balance, type and key.
+    std::map<DatagramKey, QByteArray> datagrams;
+    std::map<PayloadKey, DatagramPayload> datagramPayloads;
+    // Tallies by contest ID. Every change to a balance's amount or to the datagrams on it must update these to match.
+    std::map<std::vector<kj::byte>, ContestTally> tallies;
     kj::Maybe<capnp::Orphan<::Datagram>> pendingDatagram;
-    quint8 nextBalanceId = 0;
-
+    quint64 nextBalanceId = 0;
+
+    kj::Promise<void> storeDatagram(capnp::Orphan<::Datagram> dgram, QByteArray payerBalanceId,
+                                    QByteArray publisherBalanceId);
+    static PayloadKey payloadKey(const DatagramKey& datagram, QByteArray contentHash);
+    void referencePayload(DatagramKey datagram, QByteArray contentHash);
+    void releasePayload(const DatagramKey& datagram, QByteArray contentHash);
+    static kj::Maybe<Vote> readVote(::Datagram::Reader datagram, ::Contest::Reader contest);
+    qint64 payloadWeight(QByteArray balanceId, const DatagramPayload& payload) const;
+    void addToTally(const PayloadKey& key, const DatagramPayload& payload, qint64 weight);
+    void adjustTallies(QByteArray balanceId, quint64 coinId, qint64 amountChange);
     kj::Maybe<capnp::Orphan<Balance>&> getBalanceOrphan(QByteArray id);
     kj::Maybe<const capnp::Orphan<Balance>&> getBalanceOrphan(QByteArray id) const;
     kj::Maybe<capnp::Orphan<Coin>&> getCoinOrphan(QString name);
     kj::Maybe<const capnp::Orphan<Coin>&> getCoinOrphan(QString name) const;
     ::Contest::Builder createContest();
+    /// Count the decisions published on a contest before it existed. Call once the new contest is filled in.
+    void resolveDecisions(capnp::Data::Reader contestId);
     ::Balance::Builder createBalance(QString owner);
     ::Coin::Builder createCoin();
 };
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StubChainAdaptor.hpp"
+#include "decision.capnp.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+
+#include <kj/debug.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+const static int BALANCES_PER_OWNER = 8;
+const static int BALANCES_PER_CONTEST = 1000;
+const static quint64 BENCH_COIN = 1;
+const static qint64 BENCH_BALANCE_AMOUNT = 1000000000;
+const static int DECISION_COUNT = 3;
+
+QByteArray toByteArray(capnp::Data::Reader data) {
+    return QByteArray(reinterpret_cast<const char*>(data.begin()), static_cast<int>(data.size()));
+}
+
+/**
+ * @brief A StubChainAdaptor seeded with a given number of balances
+ *
+ * The balances are spread over owners of BALANCES_PER_OWNER balances each, all in BENCH_COIN. There is one contest per
+ * BALANCES_PER_CONTEST balances, and the first contest has a decision published on every balance, using one of
+ * DECISION_COUNT distinct decisions.
+ */
+class BenchAdaptor : public swv::StubChainAdaptor {
+public:
+    BenchAdaptor(size_t balanceCount) {
+        auto ownerCount = std::max<size_t>(1, balanceCount / BALANCES_PER_OWNER);
+        for (size_t i = 0; i < ownerCount; ++i)
+            owners.emplace_back(QStringLiteral("bench-account-%1").arg(i));
+        for (size_t i = 0; i < balanceCount; ++i) {
+            auto balance = createBalance(owners[i % ownerCount]);
+            balance.setType(BENCH_COIN);
+            balance.setAmount(BENCH_BALANCE_AMOUNT);
+            balanceIds.emplace_back(toByteArray(balance.asReader().getId()));
+        }
+
+        // Copy the demo contest, but keep the IDs createContest assigns
+        auto prototype = contests.back().getReader().getContest();
+        votedContest = toByteArray(prototype.getId());
+        contestIds.emplace_back(votedContest);
+        auto contestCount = balanceCount / BALANCES_PER_CONTEST;
+        for (size_t i = 1; i < contestCount; ++i) {
+            auto contest = createContest();
+            auto id = toByteArray(contest.getContest().getId());
+            contest.setContest(prototype);
+            contest.getContest().setId(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(id.constData()),
+                                                           static_cast<size_t>(id.size())));
+            contestIds.emplace_back(id);
+        }
+
+        // Publish each decision once, then reference it from the rest of the balances directly, as publishing on
+        // each balance would take as long as the benchmarks themselves
+        for (int i = 0; i < DECISION_COUNT; ++i) {
+            decisions.emplace_back(kj::heap<capnp::MallocMessageBuilder>());
+            auto datagram = decisions.back()->initRoot<::Datagram>();
+            datagram.initIndex().setType(::Datagram::DatagramType::DECISION);
+            datagram.getIndex().setKey(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(votedContest.constData()),
+                                                           static_cast<size_t>(votedContest.size())));
+
+            capnp::MallocMessageBuilder decisionMessage;
+            auto decision = decisionMessage.initRoot<::Decision>();
+            decision.setContest(datagram.getIndex().getKey());
+            decision.initOpinions(1)[0].setContestant(i);
+            decision.getOpinions()[0].setOpinion(1);
+            datagram.setContent(capnp::messageToFlatArray(decisionMessage).asBytes());
+
+            decisionDatagrams.emplace_back(datagram.asReader());
+            if (size_t(i) < balanceIds.size())
+                publishDatagram(balanceIds[i], balanceIds[i], datagram.asReader());
+        }
+        std::vector<kj::byte> key(votedContest.begin(), votedContest.end());
+        for (size_t i = DECISION_COUNT; i < balanceIds.size(); ++i) {
+            auto& hash = datagrams.at(DatagramKey(balanceIds[i % DECISION_COUNT], ::Datagram::DatagramType::DECISION,
+                                                  key));
+            referencePayload(DatagramKey(balanceIds[i], ::Datagram::DatagramType::DECISION, key), hash);
+        }
+    }
+
+    std::vector<QString> owners;
+    std::vector<QByteArray> balanceIds;
+    std::vector<QByteArray> contestIds;
+    QByteArray votedContest;
+    std::vector<kj::Own<capnp::MallocMessageBuilder>> decisions;
+    std::vector<::Datagram::Reader> decisionDatagrams;
+};
+
+struct Benchmark {
+    QString name;
+    std::function<void(BenchAdaptor&, ::Backend::Client&, std::mt19937_64&, kj::WaitScope&)> operation;
+    // Scale and time per operation of the last run, used to skip runs which would not finish within the time budget
+    qint64 lastScale = 0;
+    double lastNsPerOp = 0;
+};
+
+void emitRecord(const QJsonObject& record) {
+    std::cout << QJsonDocument(record).toJson(QJsonDocument::Compact).constData() << std::endl;
+}
+
+} // anonymous namespace
+
+/*
+ * Runs each benchmark against StubChainAdaptors seeded at each scale, and prints one JSON object per line for each
+ * benchmark and scale, so runs on different commits can be diffed. Each benchmark runs until it completes its
+ * iterations or exhausts its time budget. Where a benchmark's last run, extrapolated quadratically, predicts a single
+ * operation would exceed the budget at the next scale, a skipped record is printed instead.
+ */
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("StubChainAdaptorBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks for StubChainAdaptor operations");
+    parser.addHelpOption();
+    parser.addOption({"scales", "Comma-separated numbers of balances to seed", "scales",
+                      "1000,10000,100000,1000000,10000000"});
+    parser.addOption({"iterations", "Maximum operations per benchmark and scale", "count", "1000"});
+    parser.addOption({"max-seconds", "Time budget per benchmark and scale", "seconds", "5"});
+    parser.addOption({"seed", "Seed for the random choice of operands", "seed", "1"});
+    parser.addOption({"filter", "Only run benchmarks whose names contain this", "name"});
+    parser.process(app);
+
+    std::vector<qint64> scales;
+    for (const auto& scale : parser.value("scales").split(',', QString::SkipEmptyParts))
+        scales.emplace_back(scale.toLongLong());
+    auto iterations = parser.value("iterations").toLongLong();
+    auto budget = std::chrono::duration<double>(parser.value("max-seconds").toDouble());
+    auto seed = parser.value("seed").toULongLong();
+
+    kj::EventLoop loop;
+    kj::WaitScope waitScope(loop);
+
+    using Type = ::Datagram::DatagramType;
+    auto pick = [](const auto& items, std::mt19937_64& random) -> const auto& {
+        return items[std::uniform_int_distribution<size_t>(0, items.size() - 1)(random)];
+    };
+    std::vector<Benchmark> benchmarks = {
+        {"getBalance", [pick](BenchAdaptor& adaptor, ::Backend::Client&, std::mt19937_64& random, kj::WaitScope& ws) {
+             adaptor.getBalance(pick(adaptor.balanceIds, random)).wait(ws);
+         }},
+        {"getBalancesForOwner", [pick](BenchAdaptor& adaptor, ::Backend::Client&, std::mt19937_64& random,
+                                       kj::WaitScope& ws) {
+             adaptor.getBalancesForOwner(pick(adaptor.owners, random)).wait(ws);
+         }},
+        {"getContest", [pick](BenchAdaptor& adaptor, ::Backend::Client&, std::mt19937_64& random, kj::WaitScope& ws) {
+             adaptor.getContest(pick(adaptor.contestIds, random)).wait(ws);
+         }},
+        {"getDatagram", [pick](BenchAdaptor& adaptor, ::Backend::Client&, std::mt19937_64& random, kj::WaitScope& ws) {
+             adaptor.getDatagram(pick(adaptor.balanceIds, random), Type::DECISION, adaptor.votedContest).wait(ws);
+         }},
+        {"publishDatagram", [pick](BenchAdaptor& adaptor, ::Backend::Client&, std::mt19937_64& random,
+                                   kj::WaitScope& ws) {
+             auto& balanceId = pick(adaptor.balanceIds, random);
+             adaptor.publishDatagram(balanceId, balanceId, pick(adaptor.decisionDatagrams, random)).wait(ws);
+         }},
+        {"tally", [](BenchAdaptor& adaptor, ::Backend::Client& backend, std::mt19937_64&, kj::WaitScope& ws) {
+             auto request = backend.getContestResultsRequest();
+             request.setContestId(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(adaptor.votedContest.constData()),
+                                                      static_cast<size_t>(adaptor.votedContest.size())));
+             request.send().wait(ws);
+         }},
+        // Transfers create balances, so run them last
+        {"transfer", [pick](BenchAdaptor& adaptor, ::Backend::Client&, std::mt19937_64& random, kj::WaitScope& ws) {
+             adaptor.transfer(pick(adaptor.owners, random), pick(adaptor.owners, random), 1, BENCH_COIN).wait(ws);
+         }},
+    };
+    if (parser.isSet("filter")) {
+        auto filter = parser.value("filter");
+        benchmarks.erase(std::remove_if(benchmarks.begin(), benchmarks.end(), [filter](const Benchmark& b) {
+            return !b.name.contains(filter);
+        }), benchmarks.end());
+    }
+
+    for (auto scale : scales) {
+        auto seedStart = std::chrono::steady_clock::now();
+        BenchAdaptor adaptor(static_cast<size_t>(scale));
+        auto backend = adaptor.getBackendStub();
+        emitRecord({{"benchmark", "seed"}, {"scale", scale},
+                    {"totalNs", double(std::chrono::nanoseconds(std::chrono::steady_clock::now() - seedStart).count())}});
+
+        for (auto& benchmark : benchmarks) {
+            QJsonObject record{{"benchmark", benchmark.name}, {"scale", scale}};
+            if (benchmark.lastScale > 0) {
+                double growth = double(scale) / benchmark.lastScale;
+                if (benchmark.lastNsPerOp * growth * growth > std::chrono::duration<double, std::nano>(budget).count()) {
+                    record["skipped"] = "Predicted single operation time exceeds the time budget";
+                    emitRecord(record);
+                    continue;
+                }
+            }
+
+            std::mt19937_64 random(seed);
+            qint64 count = 0;
+            auto start = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::steady_clock::duration::zero();
+            try {
+                while (count < iterations && elapsed < budget) {
+                    benchmark.operation(adaptor, backend, random, waitScope);
+                    ++count;
+                    elapsed = std::chrono::steady_clock::now() - start;
+                }
+            } catch (kj::Exception& e) {
+                record["error"] = QString::fromStdString(e.getDescription().cStr());
+            }
+
+            double totalNs = std::chrono::nanoseconds(elapsed).count();
+            benchmark.lastScale = scale;
+            benchmark.lastNsPerOp = count? totalNs / count : totalNs;
+            record["iterations"] = count;
+            record["totalNs"] = totalNs;
+            record["nsPerOp"] = benchmark.lastNsPerOp;
+            emitRecord(record);
+        }
+    }
+
+    return 0;
+}
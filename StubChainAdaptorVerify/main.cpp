@@ -0,0 +1,292 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StubChainAdaptor.hpp"
+#include "decision.capnp.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+
+#include <kj/debug.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const static int OWNER_COUNT = 4;
+const static int BALANCES_PER_OWNER = 3;
+const static int CONTEST_COUNT = 3;
+// Contests which are only created partway through a stream, so decisions may be published on them beforehand
+const static int LATE_CONTEST_COUNT = 2;
+const static int CONTESTANT_COUNT = 3;
+const static int WRITE_IN_COUNT = 2;
+const static quint64 COINS[] = {1, 3};
+
+struct Operation {
+    enum Type { Publish, Transfer, Consolidate, Create } type;
+    // Operands are raw random numbers, reduced modulo the size of whatever they select from when the operation is
+    // applied. That way any subsequence of a stream is a valid stream, which is what lets failing streams be shrunk.
+    quint32 a, b, c, d;
+
+    std::string toString() const {
+        std::ostringstream out;
+        out << (type == Publish? "publish" : type == Transfer? "transfer" :
+                type == Consolidate? "consolidate" : "create")
+            << ' ' << a << ' ' << b << ' ' << c << ' ' << d;
+        return out.str();
+    }
+};
+
+std::string toString(const swv::StubChainAdaptor::ContestTally& tally) {
+    std::ostringstream out;
+    out << '{';
+    for (const auto& contestant : tally.contestants)
+        out << ' ' << contestant.first << ':' << contestant.second;
+    for (const auto& writeIn : tally.writeIns)
+        out << " \"" << writeIn.first.cStr() << "\":" << writeIn.second;
+    out << " }";
+    return out.str();
+}
+
+/**
+ * @brief A StubChainAdaptor with a few owners, balances and contests, which applies Operations to itself
+ *
+ * The balances and contests are spread over two coins, so that some decisions are published on balances in a coin other
+ * than their contest's. A few contests don't exist until a Create operation makes them, so decisions are also published
+ * before their contests are created.
+ */
+class VerifyAdaptor : public swv::StubChainAdaptor {
+public:
+    VerifyAdaptor() {
+        for (int i = 0; i < OWNER_COUNT; ++i) {
+            owners.emplace_back(QStringLiteral("verify-account-%1").arg(i));
+            for (int j = 0; j < BALANCES_PER_OWNER; ++j) {
+                auto balance = createBalance(owners.back());
+                balance.setType(COINS[j % 2]);
+                balance.setAmount(1000 + 137 * (i * BALANCES_PER_OWNER + j));
+            }
+        }
+        for (int i = 0; i < CONTEST_COUNT; ++i) {
+            auto contest = createContest().getContest();
+            fillContest(contest, i);
+            auto id = contest.asReader().getId();
+            contestIds.emplace_back(reinterpret_cast<const char*>(id.begin()), static_cast<int>(id.size()));
+        }
+        // Late contests get IDs of their own, which createContest will never assign
+        for (int i = 0; i < LATE_CONTEST_COUNT; ++i)
+            contestIds.emplace_back(QStringLiteral("late-contest-%1").arg(i).toUtf8());
+    }
+
+    void apply(const Operation& operation) {
+        // Operations may legitimately fail, such as a transfer of more than the sender holds. The tallies must match
+        // regardless.
+        try {
+            auto& owner = owners[operation.a % owners.size()];
+            switch (operation.type) {
+            case Operation::Publish: {
+                auto& ownerBalances = balances[owner];
+                if (ownerBalances.empty())
+                    return;
+                auto id = ownerBalances[operation.b % ownerBalances.size()].getReader().getId();
+                QByteArray balanceId(reinterpret_cast<const char*>(id.begin()), static_cast<int>(id.size()));
+                publishDatagram(balanceId, balanceId, makeDecision(contestIds[operation.c % contestIds.size()],
+                                                                   operation.d));
+                break;
+            }
+            case Operation::Transfer:
+                transfer(owner, owners[operation.b % owners.size()], 1 + operation.c % 3000, COINS[operation.d % 2]);
+                break;
+            case Operation::Consolidate:
+                consolidateBalances(owner, COINS[operation.b % 2]);
+                break;
+            case Operation::Create: {
+                auto index = operation.b % contestIds.size();
+                capnp::Data::Reader id(reinterpret_cast<const kj::byte*>(contestIds[index].constData()),
+                                       static_cast<size_t>(contestIds[index].size()));
+                if (findContest(id) != nullptr)
+                    return;
+                auto contest = createContest().getContest();
+                contest.setId(id);
+                fillContest(contest, static_cast<int>(index));
+                resolveDecisions(id);
+                break;
+            }
+            }
+        } catch (kj::Exception&) {}
+    }
+
+    /// Check every contest's tally against a recount. Returns a description of the first mismatch, or an empty string.
+    std::string checkTallies() const {
+        for (const auto& contestId : contestIds) {
+            capnp::Data::Reader id(reinterpret_cast<const kj::byte*>(contestId.constData()),
+                                   static_cast<size_t>(contestId.size()));
+            const auto& tally = getTally(id);
+            // Decisions on a contest which doesn't exist yet count toward nothing
+            auto recount = findContest(id) == nullptr? ContestTally() : recountTally(id);
+            if (tally != recount)
+                return "Contest " + contestId.toHex().toStdString() + " has tally " + toString(tally) +
+                        " but recounts to " + toString(recount);
+        }
+        return {};
+    }
+
+private:
+    std::vector<QString> owners;
+    std::vector<QByteArray> contestIds;
+    capnp::MallocMessageBuilder datagramMessage;
+
+    static void fillContest(::UnsignedContest::Builder contest, int index) {
+        contest.setCoin(COINS[index % 2]);
+        contest.setName(QStringLiteral("Verification contest %1").arg(index).toUtf8().constData());
+        auto contestants = contest.initContestants().initEntries(CONTESTANT_COUNT);
+        for (int j = 0; j < CONTESTANT_COUNT; ++j)
+            contestants[j].setKey(QStringLiteral("Contestant %1").arg(j).toUtf8().constData());
+    }
+
+    /// Build a decision datagram on the contest for the given choice: a contestant, a write-in, or an invalid decision
+    ::Datagram::Reader makeDecision(const QByteArray& contestId, quint32 choice) {
+        auto datagram = datagramMessage.initRoot<::Datagram>();
+        datagram.initIndex().setType(::Datagram::DatagramType::DECISION);
+        datagram.getIndex().setKey(capnp::Data::Reader(reinterpret_cast<const kj::byte*>(contestId.constData()),
+                                                       static_cast<size_t>(contestId.size())));
+
+        capnp::MallocMessageBuilder decisionMessage;
+        auto decision = decisionMessage.initRoot<::Decision>();
+        decision.setContest(datagram.getIndex().getKey());
+        auto opinion = decision.initOpinions(1)[0];
+        opinion.setOpinion(1);
+        choice %= CONTESTANT_COUNT + WRITE_IN_COUNT + 1;
+        if (choice < CONTESTANT_COUNT) {
+            opinion.setContestant(choice);
+        } else if (choice < CONTESTANT_COUNT + WRITE_IN_COUNT) {
+            opinion.setContestant(CONTESTANT_COUNT);
+            decision.initWriteIns().initEntries(1)[0].setKey(
+                        QStringLiteral("Write-in %1").arg(choice - CONTESTANT_COUNT).toUtf8().constData());
+        } else {
+            opinion.setContestant(CONTESTANT_COUNT + WRITE_IN_COUNT);
+        }
+        datagram.setContent(capnp::messageToFlatArray(decisionMessage).asBytes());
+        return datagram.asReader();
+    }
+};
+
+/// Generate a stream of operations, mostly publications, with the balance-changing operations and contest creations
+/// mixed in
+std::vector<Operation> generateStream(quint64 seed, size_t length) {
+    std::mt19937_64 random(seed);
+    std::uniform_int_distribution<int> typeDistribution(0, 99);
+    std::vector<Operation> operations;
+    operations.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        auto roll = typeDistribution(random);
+        auto type = roll < 50? Operation::Publish : roll < 80? Operation::Transfer :
+                    roll < 95? Operation::Consolidate : Operation::Create;
+        operations.push_back({type, quint32(random()), quint32(random()), quint32(random()), quint32(random())});
+    }
+    return operations;
+}
+
+/// Apply the operations to a fresh adaptor, checking the tallies after each. Returns the number of operations applied
+/// when a mismatch was found, or 0 if none was.
+size_t findFailure(const std::vector<Operation>& operations, std::string* mismatch = nullptr) {
+    VerifyAdaptor adaptor;
+    for (size_t i = 0; i < operations.size(); ++i) {
+        adaptor.apply(operations[i]);
+        auto result = adaptor.checkTallies();
+        if (!result.empty()) {
+            if (mismatch)
+                *mismatch = kj::mv(result);
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/// Remove operations from a failing stream, in ever smaller chunks, for as long as it still fails
+std::vector<Operation> shrink(std::vector<Operation> operations) {
+    for (size_t chunk = std::max<size_t>(1, operations.size() / 2); chunk > 0; chunk /= 2) {
+        size_t start = 0;
+        while (start < operations.size()) {
+            auto candidate = operations;
+            candidate.erase(candidate.begin() + start,
+                            candidate.begin() + std::min(start + chunk, candidate.size()));
+            if (auto failedAt = findFailure(candidate)) {
+                candidate.resize(failedAt);
+                operations = kj::mv(candidate);
+            } else {
+                start += chunk;
+            }
+        }
+    }
+    return operations;
+}
+
+} // anonymous namespace
+
+/*
+ * Drives StubChainAdaptors with seeded random streams of publications, replacements, transfers, consolidations and
+ * contest creations, checking every contest's incrementally maintained tally against a recount after each operation.
+ * On a mismatch, the failing stream is shrunk to a minimal one, which is printed with its seed before exiting with
+ * failure.
+ */
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("StubChainAdaptorVerify");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Differential verifier for StubChainAdaptor's incremental tallies");
+    parser.addHelpOption();
+    parser.addOption({"seed", "Seed of the first stream; each stream's seed is one more than the last's", "seed", "1"});
+    parser.addOption({"streams", "Number of streams to run", "count", "10000"});
+    parser.addOption({"length", "Number of operations in each stream", "count", "200"});
+    parser.process(app);
+
+    auto seed = parser.value("seed").toULongLong();
+    auto streams = parser.value("streams").toULongLong();
+    auto length = parser.value("length").toULongLong();
+
+    // Invalid decisions are generated on purpose; don't log a warning for each one
+    kj::_::Debug::setLogLevel(kj::_::Debug::Severity::ERROR);
+
+    for (quint64 stream = 0; stream < streams; ++stream) {
+        auto operations = generateStream(seed + stream, length);
+        if (auto failedAt = findFailure(operations)) {
+            operations.resize(failedAt);
+            operations = shrink(kj::mv(operations));
+            std::string mismatch;
+            findFailure(operations, &mismatch);
+
+            std::cout << "Tally mismatch in stream with seed " << seed + stream << ", shrunk to "
+                      << operations.size() << " operations:" << std::endl;
+            for (const auto& operation : operations)
+                std::cout << "  " << operation.toString() << std::endl;
+            std::cout << mismatch << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Verified " << streams * length << " operations in " << streams << " streams" << std::endl;
+    return 0;
+}
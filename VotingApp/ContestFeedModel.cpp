@@ -0,0 +1,282 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ContestFeedModel.hpp"
+#include "PromiseConverter.hpp"
+#include "wrappers/ChainAdaptorWrapper.hpp"
+#include "wrappers/ContestGeneratorWrapper.hpp"
+#include "wrappers/Contest.hpp"
+
+#include <QPointer>
+#include <QQmlEngine>
+
+#include <kj/debug.h>
+
+#include <algorithm>
+
+namespace swv {
+
+ContestFeedModel::ContestFeedModel(ContestGeneratorWrapper* generator, ChainAdaptorWrapper& adaptor,
+                                   PromiseConverter& converter, QObject* parent)
+    : QAbstractListModel(parent),
+      m_pageSize(5),
+      m_prefetchWindow(10),
+      m_retainWindow(20),
+      m_loading(false),
+      m_atEnd(generator == nullptr),
+      generator(generator),
+      adaptor(adaptor),
+      converter(converter)
+{
+    if (generator) {
+        // The generator is only useful to us, and must live as long as we page through it
+        generator->setParent(this);
+        QQmlEngine::setObjectOwnership(generator, QQmlEngine::CppOwnership);
+    }
+
+    connect(this, &ContestFeedModel::prefetchWindowChanged, this, [this] { updateWindow(); });
+    connect(this, &ContestFeedModel::retainWindowChanged, this, [this] { updateWindow(); });
+    updateWindow();
+}
+
+ContestFeedModel::~ContestFeedModel() noexcept
+{}
+
+void ContestFeedModel::setViewport(int firstVisible, int lastVisible)
+{
+    if (firstVisible >= 0)
+        this->firstVisible = firstVisible;
+    if (lastVisible >= 0)
+        this->lastVisible = lastVisible;
+    this->lastVisible = std::max(this->firstVisible, this->lastVisible);
+    updateWindow();
+}
+
+int ContestFeedModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return count();
+}
+
+QVariant ContestFeedModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return {};
+
+    const auto& row = rows[index.row()];
+    switch (role) {
+    case ContestIdRole:
+        return QVariant::fromValue(row.contestId);
+    case ContestObjectRole:
+        return QVariant::fromValue<QObject*>(row.contest);
+    case VotingStakeRole:
+        return row.votingStake;
+    case TracksLiveResultsRole:
+        return row.tracksLiveResults;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> ContestFeedModel::roleNames() const
+{
+    return {{ContestIdRole, "contestId"},
+            {ContestObjectRole, "contestObject"},
+            {VotingStakeRole, "votingStake"},
+            {TracksLiveResultsRole, "tracksLiveResults"}};
+}
+
+void ContestFeedModel::updateWindow()
+{
+    if (lastVisible + get_prefetchWindow() >= rows.size())
+        requestPage();
+
+    int first = std::max(0, firstVisible - get_retainWindow());
+    int last = std::min(rows.size() - 1, lastVisible + get_retainWindow());
+    if (last < first) {
+        first = 0;
+        last = -1;
+    }
+
+    // Only the rows entering or leaving the retained range need attention, so a scroll step touches a handful of
+    // rows however long the feed is. Release the contests which have scrolled well out of view...
+    for (int i = retainedFirst; i <= std::min(retainedLast, first - 1); ++i)
+        releaseContest(i);
+    for (int i = std::max(retainedFirst, last + 1); i <= retainedLast; ++i)
+        releaseContest(i);
+
+    // ...and reload those coming back into it
+    QList<int> reload;
+    auto addReload = [this, &reload](int i) {
+        if (rows[i].contest == nullptr && !rows[i].loadingContest)
+            reload.append(i);
+    };
+    for (int i = first; i <= std::min(last, retainedFirst - 1); ++i)
+        addReload(i);
+    for (int i = std::max(first, retainedLast + 1); i <= last; ++i)
+        addReload(i);
+
+    retainedFirst = first;
+    retainedLast = last;
+    if (!reload.isEmpty())
+        reloadContests(reload);
+}
+
+void ContestFeedModel::requestPage()
+{
+    if (get_loading() || get_atEnd())
+        return;
+    update_loading(true);
+
+    auto requested = get_pageSize();
+    QPointer<ContestFeedModel> self(this);
+    // Covers the whole page load: the generator request, the contest lookups and inserting the rows
+    auto span = Tracer::begin("ContestFeedModel::requestPage");
+    auto promise = generator->_getContests(requested, span).then(
+                       [this, requested, self](capnp::Response<ContestGenerator::GetContestsResults> response)
+                       -> kj::Promise<void> {
+        if (self.isNull())
+            return kj::READY_NOW;
+
+        auto listedContests = response.getNextContests();
+        auto page = KJ_MAP(listed, listedContests) {
+            return Row{BinaryId(listed.getContestId()), qint64(listed.getVotingStake()),
+                       listed.getTracksLiveResults()};
+        };
+        auto ids = KJ_MAP(row, page) { return row.contestId.bytes(); };
+        return adaptor._getContests(kj::mv(ids)).then(
+                    [this, requested, self, page = kj::mv(page)](QList<ContestWrapper*> contests) mutable {
+            if (self.isNull()) {
+                qDeleteAll(contests);
+                return;
+            }
+            appendPage(kj::mv(page), contests, requested);
+        });
+    }).then([] {}, [this, self](kj::Exception&& e) {
+        if (self.isNull())
+            return;
+        update_loading(false);
+        emit error(tr("Unable to load contests: %1").arg(QString::fromStdString(e.getDescription())));
+    }).attach(kj::mv(span));
+    converter.adopt(kj::mv(promise));
+}
+
+void ContestFeedModel::appendPage(kj::Array<Row> page, QList<ContestWrapper*> contests, int requested)
+{
+    QVector<Row> newRows;
+    newRows.reserve(static_cast<int>(page.size()));
+    for (uint i = 0; i < page.size(); ++i) {
+        if (contests[i] == nullptr) {
+            KJ_LOG(WARNING, "Contest from generator not found on chain", page[i].contestId.toString().toStdString());
+            continue;
+        }
+        // A row landing beyond the retained range starts out released, as updateWindow only visits rows whose
+        // retention changes
+        if (isRetained(rows.size() + newRows.size())) {
+            adoptContest(contests[i]);
+            page[i].contest = contests[i];
+        } else {
+            delete contests[i];
+        }
+        newRows.append(page[i]);
+    }
+
+    if (!newRows.isEmpty()) {
+        beginInsertRows({}, rows.size(), rows.size() + newRows.size() - 1);
+        rows += newRows;
+        endInsertRows();
+        emit countChanged();
+    }
+
+    update_loading(false);
+    if (page.size() < static_cast<uint>(requested))
+        update_atEnd(true);
+    // Either keep filling the prefetch window or release what the new rows pushed out of the retained range
+    updateWindow();
+}
+
+void ContestFeedModel::releaseContest(int index)
+{
+    auto& row = rows[index];
+    if (row.contest == nullptr)
+        return;
+    row.contest->deleteLater();
+    row.contest = nullptr;
+    auto changedIndex = this->index(index);
+    emit dataChanged(changedIndex, changedIndex, {ContestObjectRole});
+}
+
+void ContestFeedModel::reloadContests(QList<int> indexes)
+{
+    auto ids = kj::heapArrayBuilder<QByteArray>(indexes.size());
+    for (int i : indexes) {
+        rows[i].loadingContest = true;
+        ids.add(rows[i].contestId.bytes());
+    }
+
+    QPointer<ContestFeedModel> self(this);
+    auto promise = adaptor._getContests(ids.finish()).then([this, self, indexes](QList<ContestWrapper*> contests) {
+        if (self.isNull()) {
+            qDeleteAll(contests);
+            return;
+        }
+        restoreContests(indexes, contests);
+    }, [this, self, indexes](kj::Exception&& e) {
+        if (self.isNull())
+            return;
+        for (int i : indexes)
+            rows[i].loadingContest = false;
+        emit error(tr("Unable to reload contests: %1").arg(QString::fromStdString(e.getDescription())));
+    });
+    converter.adopt(kj::mv(promise));
+}
+
+void ContestFeedModel::restoreContests(QList<int> indexes, QList<ContestWrapper*> contests)
+{
+    for (int i = 0; i < indexes.size(); ++i) {
+        auto& row = rows[indexes[i]];
+        auto contest = contests[i];
+        row.loadingContest = false;
+        if (contest == nullptr)
+            continue;
+        // The view may have moved on while we were loading
+        if (!isRetained(indexes[i]) || row.contest != nullptr) {
+            delete contest;
+            continue;
+        }
+
+        adoptContest(contest);
+        row.contest = contest;
+        auto changedIndex = index(indexes[i]);
+        emit dataChanged(changedIndex, changedIndex, {ContestObjectRole});
+    }
+}
+
+bool ContestFeedModel::isRetained(int index) const
+{
+    return index >= firstVisible - get_retainWindow() && index <= lastVisible + get_retainWindow();
+}
+
+void ContestFeedModel::adoptContest(ContestWrapper* contest)
+{
+    contest->setParent(this);
+    QQmlEngine::setObjectOwnership(contest, QQmlEngine::CppOwnership);
+}
+
+} // namespace swv
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTESTFEEDMODEL_HPP
+#define CONTESTFEEDMODEL_HPP
+
+#include "wrappers/BinaryId.hpp"
+
+#include "vendor/QQmlVarPropertyHelpers.h"
+
+#include <QAbstractListModel>
+#include <QVector>
+
+#include <kj/array.h>
+
+class PromiseConverter;
+
+namespace swv {
+
+class ChainAdaptorWrapper;
+class ContestGeneratorWrapper;
+class ContestWrapper;
+
+/**
+ * @brief The ContestFeedModel class is a list model of the contests produced by a ContestGeneratorWrapper
+ *
+ * The view reports which rows it is showing with @ref setViewport, and the model keeps prefetchWindow rows loaded
+ * beyond the last visible one. It requests pageSize contests from the generator at a time, resolves each page against
+ * the chain with a single lookup, and inserts the page into the model at once.
+ *
+ * Rows are never removed, but to cap memory use on long feeds, the contest objects of rows more than retainWindow rows
+ * outside the viewport are released. Their contestObject becomes null, and they are loaded again, in one batch, when
+ * they come back into the retained range. The model owns the contest objects it exposes.
+ */
+class ContestFeedModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    /// Number of contests to request from the generator at a time
+    QML_WRITABLE_VAR_PROPERTY(int, pageSize)
+    /// Number of rows to keep loaded beyond the last visible row
+    QML_WRITABLE_VAR_PROPERTY(int, prefetchWindow)
+    /// Number of rows on either side of the viewport whose contest objects are kept in memory
+    QML_WRITABLE_VAR_PROPERTY(int, retainWindow)
+    /// Whether a page is currently being fetched
+    QML_READONLY_VAR_PROPERTY(bool, loading)
+    /// Whether the generator has run out of contests
+    QML_READONLY_VAR_PROPERTY(bool, atEnd)
+
+public:
+    enum Roles {
+        ContestIdRole = Qt::UserRole,
+        ContestObjectRole,
+        VotingStakeRole,
+        TracksLiveResultsRole
+    };
+
+    /// The model takes ownership of generator
+    ContestFeedModel(ContestGeneratorWrapper* generator, ChainAdaptorWrapper& adaptor, PromiseConverter& converter,
+                     QObject* parent = nullptr);
+    virtual ~ContestFeedModel() noexcept;
+
+    int count() const {
+        return rows.size();
+    }
+
+    /**
+     * @brief Tell the model which rows the view is showing
+     * @param firstVisible Index of the first visible row, or -1 to leave it unchanged
+     * @param lastVisible Index of the last visible row, or -1 to leave it unchanged
+     *
+     * This is cheap enough to call on every scroll step.
+     */
+    Q_INVOKABLE void setViewport(int firstVisible, int lastVisible);
+
+    // QAbstractItemModel interface
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex& index, int role) const;
+    virtual QHash<int, QByteArray> roleNames() const;
+
+signals:
+    void countChanged();
+    void error(QString message);
+
+private:
+    struct Row {
+        BinaryId contestId;
+        qint64 votingStake;
+        bool tracksLiveResults;
+        ContestWrapper* contest = nullptr;
+        bool loadingContest = false;
+    };
+
+    ContestGeneratorWrapper* generator;
+    ChainAdaptorWrapper& adaptor;
+    PromiseConverter& converter;
+    QVector<Row> rows;
+    int firstVisible = 0;
+    int lastVisible = -1;
+    // Rows retained as of the last updateWindow; all rows outside this range have had their contests released
+    int retainedFirst = 0;
+    int retainedLast = -1;
+
+    void updateWindow();
+    void requestPage();
+    void appendPage(kj::Array<Row> page, QList<ContestWrapper*> contests, int requested);
+    void releaseContest(int index);
+    void reloadContests(QList<int> indexes);
+    void restoreContests(QList<int> indexes, QList<ContestWrapper*> contests);
+    bool isRetained(int index) const;
+    void adoptContest(ContestWrapper* contest);
+};
+
+} // namespace swv
+
+#endif // CONTESTFEEDMODEL_HPP
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ContestResultsModel.hpp"
+#include "PromiseConverter.hpp"
+#include "wrappers/Converters.hpp"
+
+#include <purchase.capnp.h>
+
+#include <QPointer>
+
+#include <kj/debug.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace swv {
+
+// Sorts write-ins after the contestants with equal tallies
+const static qint32 WRITE_IN = std::numeric_limits<qint32>::max();
+
+namespace {
+class ResultsNotifier : public Notifier<capnp::List<ContestResultsModel::TalliedOpinion>>::Server {
+    QPointer<ContestResultsModel> model;
+
+    virtual ::kj::Promise<void> notify(NotifyContext context) {
+        if (!model.isNull())
+            model->update(context.getParams().getMessage());
+        return kj::READY_NOW;
+    }
+
+public:
+    ResultsNotifier(ContestResultsModel* model) : model(model) {}
+};
+} // anonymous namespace
+
+ContestResultsModel::ContestResultsModel(Backend::ContestResults::Client results, PromiseConverter& converter,
+                                         QObject* parent)
+    : QAbstractListModel(parent),
+      results(kj::mv(results))
+{
+    auto request = this->results.subscribeRequest();
+    request.setNotifier(kj::heap<ResultsNotifier>(this));
+    converter.adopt(request.send().then([](capnp::Response<Backend::ContestResults::SubscribeResults>) {}));
+
+    // The backend needn't notify until the results change, so get the current results as well
+    QPointer<ContestResultsModel> self(this);
+    converter.adopt(this->results.resultsRequest().send().then(
+                        [self](capnp::Response<Backend::ContestResults::ResultsResults> response) {
+        if (!self.isNull())
+            self->update(response.getResults());
+    }));
+}
+
+ContestResultsModel::~ContestResultsModel() noexcept
+{}
+
+void ContestResultsModel::update(capnp::List<TalliedOpinion>::Reader results)
+{
+    auto oldCount = rows.size();
+    QHash<Key, qint64> newTallies;
+    newTallies.reserve(static_cast<int>(results.size()));
+    for (auto opinion : results)
+        newTallies.insert(keyOf(opinion), opinion.getTally());
+
+    // Remove the rows which are no longer in the results
+    for (auto itr = tallies.begin(); itr != tallies.end();) {
+        if (newTallies.contains(itr.key())) {
+            ++itr;
+            continue;
+        }
+        auto row = insertionPoint({itr.key(), itr.value()});
+        beginRemoveRows({}, row, row);
+        rows.remove(row);
+        endRemoveRows();
+        itr = tallies.erase(itr);
+    }
+
+    // Add the new rows, and move and update the ones whose tallies changed
+    for (auto itr = newTallies.begin(); itr != newTallies.end(); ++itr) {
+        auto existing = tallies.find(itr.key());
+        if (existing == tallies.end()) {
+            Row row{itr.key(), itr.value()};
+            auto position = insertionPoint(row);
+            beginInsertRows({}, position, position);
+            rows.insert(position, row);
+            endInsertRows();
+            tallies.insert(itr.key(), itr.value());
+        } else if (existing.value() != itr.value()) {
+            auto from = insertionPoint({itr.key(), existing.value()});
+            existing.value() = itr.value();
+            retally(from, itr.value());
+        }
+    }
+
+    if (rows.size() != oldCount)
+        emit countChanged();
+}
+
+int ContestResultsModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return count();
+}
+
+QVariant ContestResultsModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return {};
+
+    const auto& row = rows[index.row()];
+    switch (role) {
+    case ContestantRole:
+        return row.key.first == WRITE_IN ? -1 : row.key.first;
+    case WriteInRole:
+        return row.key.second;
+    case TallyRole:
+        return row.tally;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> ContestResultsModel::roleNames() const
+{
+    return {{ContestantRole, "contestant"},
+            {WriteInRole, "writeIn"},
+            {TallyRole, "tally"}};
+}
+
+ContestResultsModel::Key ContestResultsModel::keyOf(TalliedOpinion::Reader opinion)
+{
+    auto contestant = opinion.getContestant();
+    if (contestant.isWriteIn())
+        return {WRITE_IN, convertText(contestant.getWriteIn())};
+    return {contestant.getContestant(), {}};
+}
+
+bool ContestResultsModel::ranksBefore(const ContestResultsModel::Row& a, const ContestResultsModel::Row& b)
+{
+    if (a.tally != b.tally)
+        return a.tally > b.tally;
+    return a.key < b.key;
+}
+
+int ContestResultsModel::insertionPoint(const ContestResultsModel::Row& row) const
+{
+    return static_cast<int>(std::lower_bound(rows.begin(), rows.end(), row, ranksBefore) - rows.begin());
+}
+
+void ContestResultsModel::retally(int from, qint64 tally)
+{
+    // Find where the row goes among the others. They are still in order, as only this row's tally has changed.
+    Row updated{rows[from].key, tally};
+    auto destination = insertionPoint(updated);
+    // If the row moves down, the destination counts the row itself, which is leaving its old position
+    auto to = destination > from ? destination - 1 : destination;
+
+    if (to != from) {
+        beginMoveRows({}, from, from, {}, destination);
+        if (to < from)
+            std::rotate(rows.begin() + to, rows.begin() + from, rows.begin() + from + 1);
+        else
+            std::rotate(rows.begin() + from, rows.begin() + from + 1, rows.begin() + to + 1);
+        endMoveRows();
+    }
+
+    rows[to].tally = tally;
+    auto changedIndex = index(to);
+    emit dataChanged(changedIndex, changedIndex, {TallyRole});
+}
+
+} // namespace swv
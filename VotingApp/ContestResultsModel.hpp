@@ -0,0 +1,96 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONTESTRESULTSMODEL_HPP
+#define CONTESTRESULTSMODEL_HPP
+
+#include <backend.capnp.h>
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+
+class PromiseConverter;
+
+namespace swv {
+
+/**
+ * @brief The ContestResultsModel class is a list model of a contest's live results, in rank order
+ *
+ * The model subscribes to the results, and each time the backend sends a new tally, the model diffs it against the
+ * previous one. Only the rows whose tallies changed get dataChanged, and a row is only moved when its rank changes, so
+ * the cost of an update to the view is proportional to what changed, even in contests with many write-ins.
+ *
+ * Rows are ordered by tally, highest first; ties are ordered with contestants before write-ins, then by contestant
+ * index or write-in name. Each row has the roles contestant (the contestant's index, or -1 for a write-in), writeIn
+ * (the write-in name, or empty for a contestant) and tally.
+ */
+class ContestResultsModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    using TalliedOpinion = Backend::ContestResults::TalliedOpinion;
+    enum Roles {
+        ContestantRole = Qt::UserRole,
+        WriteInRole,
+        TallyRole
+    };
+
+    ContestResultsModel(Backend::ContestResults::Client results, PromiseConverter& converter,
+                        QObject* parent = nullptr);
+    virtual ~ContestResultsModel() noexcept;
+
+    int count() const {
+        return rows.size();
+    }
+
+    /// @brief Bring the model up to date with a full set of results, signalling only the differences
+    void update(capnp::List<TalliedOpinion>::Reader results);
+
+    // QAbstractItemModel interface
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex& index, int role) const;
+    virtual QHash<int, QByteArray> roleNames() const;
+
+signals:
+    void countChanged();
+
+private:
+    // Contestant index, or WRITE_IN and the write-in name
+    using Key = QPair<qint32, QString>;
+    struct Row {
+        Key key;
+        qint64 tally;
+    };
+
+    Backend::ContestResults::Client results;
+    // Rows in rank order, and the tally of each key, for diffing
+    QVector<Row> rows;
+    QHash<Key, qint64> tallies;
+
+    static Key keyOf(TalliedOpinion::Reader opinion);
+    static bool ranksBefore(const Row& a, const Row& b);
+    int insertionPoint(const Row& row) const;
+    void retally(int from, qint64 tally);
+};
+
+} // namespace swv
+
+#endif // CONTESTRESULTSMODEL_HPP
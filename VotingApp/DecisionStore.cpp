@@ -0,0 +1,260 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DecisionStore.hpp"
+
+#include <kj/debug.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace swv {
+
+constexpr quint32 DecisionStore::FORMAT_VERSION;
+
+const static char STORE_MAGIC[4] = {'S', 'W', 'V', 'D'};
+const static int HEADER_SIZE = 8;
+const static int RECORD_HEADER_SIZE = 8;
+const static int FLUSH_DELAY_MS = 500;
+// Don't bother compacting small logs, however much of them is garbage
+const static qint64 MINIMUM_COMPACTION_SIZE = 64 * 1024;
+
+DecisionStore::DecisionStore(QString path, QObject* parent)
+    : QObject(parent),
+      path(path)
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&flushTimer, &QTimer::timeout, this, &DecisionStore::flush);
+    // Mobile platforms may kill a suspended app without warning, so don't sit on pending changes when backgrounded
+    if (auto app = qobject_cast<QGuiApplication*>(QCoreApplication::instance()))
+        connect(app, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state) {
+            if (state != Qt::ApplicationActive)
+                flush();
+        });
+
+    load();
+    if (damaged || (logSize > MINIMUM_COMPACTION_SIZE && logSize > 2 * liveSize()))
+        compact();
+}
+
+DecisionStore::~DecisionStore() noexcept
+{
+    flush();
+}
+
+QString DecisionStore::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/decisions.log");
+}
+
+QByteArray DecisionStore::get(QByteArray contestId) const
+{
+    auto itr = pending.find(contestId);
+    if (itr != pending.end())
+        return *itr;
+    return records.value(contestId);
+}
+
+QHash<QByteArray, QByteArray> DecisionStore::get(QList<QByteArray> contestIds) const
+{
+    QHash<QByteArray, QByteArray> results;
+    for (const auto& id : contestIds) {
+        auto decision = get(id);
+        if (!decision.isEmpty())
+            results.insert(id, decision);
+    }
+    return results;
+}
+
+void DecisionStore::put(QByteArray contestId, QByteArray decision)
+{
+    pending.insert(contestId, decision);
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void DecisionStore::remove(QByteArray contestId)
+{
+    // An empty value is a tombstone
+    put(contestId, QByteArray());
+}
+
+void DecisionStore::flush()
+{
+    flushTimer.stop();
+    if (pending.isEmpty())
+        return;
+    if (damaged) {
+        // Appending after the damage would hide the new records from every future load
+        compact();
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile log(path);
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        KJ_LOG(WARNING, "Unable to open decision store for writing", path.toStdString(),
+               log.errorString().toStdString());
+        return;
+    }
+
+    QByteArray batch;
+    if (log.size() == 0) {
+        batch.append(STORE_MAGIC, sizeof(STORE_MAGIC));
+        quint32 version = qToLittleEndian(FORMAT_VERSION);
+        batch.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    for (auto itr = pending.begin(); itr != pending.end(); ++itr)
+        batch.append(encodeRecord(itr.key(), itr.value()));
+
+    if (log.write(batch) != batch.size() || !log.flush()) {
+        KJ_LOG(WARNING, "Unable to append to decision store", path.toStdString(), log.errorString().toStdString());
+        return;
+    }
+    logSize = log.size();
+
+    for (auto itr = pending.begin(); itr != pending.end(); ++itr)
+        if (itr.value().isEmpty())
+            records.remove(itr.key());
+        else
+            records.insert(itr.key(), itr.value());
+    pending.clear();
+
+    if (logSize > MINIMUM_COMPACTION_SIZE && logSize > 2 * liveSize())
+        compact();
+}
+
+void DecisionStore::compact()
+{
+    // Write the live records, with any pending changes folded in, to a new log
+    auto live = records;
+    for (auto itr = pending.begin(); itr != pending.end(); ++itr)
+        if (itr.value().isEmpty())
+            live.remove(itr.key());
+        else
+            live.insert(itr.key(), itr.value());
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        KJ_LOG(WARNING, "Unable to compact decision store", path.toStdString(), out.errorString().toStdString());
+        return;
+    }
+    out.write(STORE_MAGIC, sizeof(STORE_MAGIC));
+    quint32 version = qToLittleEndian(FORMAT_VERSION);
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    for (auto itr = live.begin(); itr != live.end(); ++itr)
+        out.write(encodeRecord(itr.key(), itr.value()));
+    if (!out.commit()) {
+        KJ_LOG(WARNING, "Unable to compact decision store", path.toStdString(), out.errorString().toStdString());
+        return;
+    }
+
+    // The records may be views into the old mapping, so only drop it now that the new log is written, then reload
+    live.clear();
+    records.clear();
+    pending.clear();
+    flushTimer.stop();
+    if (mapping != nullptr)
+        mappedFile.unmap(mapping);
+    mapping = nullptr;
+    mappedFile.close();
+    load();
+    KJ_LOG(DBG, "Compacted decision store", path.toStdString(), logSize);
+}
+
+void DecisionStore::load()
+{
+    damaged = false;
+    mappedFile.setFileName(path);
+    if (!mappedFile.open(QIODevice::ReadOnly))
+        return;
+
+    logSize = mappedFile.size();
+    if (logSize == 0)
+        return;
+    if (logSize < HEADER_SIZE) {
+        KJ_LOG(WARNING, "Decision store has a partial header; it will be replaced", path.toStdString());
+        damaged = true;
+        return;
+    }
+    mapping = mappedFile.map(0, logSize);
+    if (mapping == nullptr) {
+        KJ_LOG(WARNING, "Unable to map decision store", path.toStdString(), mappedFile.errorString().toStdString());
+        return;
+    }
+    if (std::memcmp(mapping, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+            qFromLittleEndian<quint32>(mapping + sizeof(STORE_MAGIC)) != FORMAT_VERSION) {
+        KJ_LOG(WARNING, "Discarding decision store from another format version", path.toStdString());
+        damaged = true;
+        return;
+    }
+
+    // Replay the log; later records supersede earlier ones
+    qint64 offset = HEADER_SIZE;
+    while (logSize - offset >= RECORD_HEADER_SIZE) {
+        auto keySize = qFromLittleEndian<quint32>(mapping + offset);
+        auto valueSize = qFromLittleEndian<quint32>(mapping + offset + 4);
+        offset += RECORD_HEADER_SIZE;
+        if (qint64(keySize) + valueSize > logSize - offset) {
+            // Most likely we were killed mid-append; everything before this record is intact
+            KJ_LOG(WARNING, "Decision store ends with a partial record; dropping it", path.toStdString(), offset);
+            damaged = true;
+            break;
+        }
+
+        auto key = QByteArray(reinterpret_cast<const char*>(mapping + offset), keySize);
+        offset += keySize;
+        if (valueSize == 0)
+            records.remove(key);
+        else
+            records.insert(key, QByteArray::fromRawData(reinterpret_cast<const char*>(mapping + offset), valueSize));
+        offset += valueSize;
+    }
+    if (offset < logSize && !damaged) {
+        KJ_LOG(WARNING, "Decision store ends with a partial record header; dropping it", path.toStdString(), offset);
+        damaged = true;
+    }
+}
+
+qint64 DecisionStore::liveSize() const
+{
+    qint64 size = HEADER_SIZE;
+    for (auto itr = records.begin(); itr != records.end(); ++itr)
+        size += RECORD_HEADER_SIZE + itr.key().size() + itr.value().size();
+    return size;
+}
+
+QByteArray DecisionStore::encodeRecord(const QByteArray& key, const QByteArray& value)
+{
+    QByteArray record(RECORD_HEADER_SIZE, Qt::Uninitialized);
+    qToLittleEndian<quint32>(key.size(), reinterpret_cast<uchar*>(record.data()));
+    qToLittleEndian<quint32>(value.size(), reinterpret_cast<uchar*>(record.data()) + 4);
+    record.append(key);
+    record.append(value);
+    return record;
+}
+
+} // namespace swv
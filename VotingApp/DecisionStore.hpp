@@ -0,0 +1,89 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DECISIONSTORE_HPP
+#define DECISIONSTORE_HPP
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QTimer>
+
+namespace swv {
+
+/**
+ * @brief The DecisionStore class persists the user's uncast decisions, keyed by contest ID
+ *
+ * The store is a single append-only log file, memory-mapped when the store is opened. Writes are batched in memory
+ * and appended to the log in one write shortly after the first change, so a burst of edits costs a single small
+ * append rather than a rewrite of the whole store per edit. When superseded records make up most of the log, it is
+ * rewritten with only the live records. A log whose header is unreadable, or which ends with a partial record (as when
+ * the app is killed mid-append), is likewise rewritten with the records which could be read, so later appends are
+ * never stranded behind bytes no load can get past.
+ *
+ * Values returned by @ref get may share memory with the store. They are valid until control returns to the event
+ * loop, and should be deserialized or copied right away.
+ */
+class DecisionStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Bump whenever the record format changes; a log written with another version is discarded and replaced
+    static constexpr quint32 FORMAT_VERSION = 1;
+
+    explicit DecisionStore(QString path = defaultPath(), QObject* parent = nullptr);
+    virtual ~DecisionStore() noexcept;
+
+    /// @brief Get the location of the store in the platform's application data directory
+    static QString defaultPath();
+
+    /// @brief Get the serialized decision for a contest, or an empty array if none is stored
+    QByteArray get(QByteArray contestId) const;
+    /// @brief Get the serialized decisions for several contests in one pass. Contests with no decision are omitted.
+    QHash<QByteArray, QByteArray> get(QList<QByteArray> contestIds) const;
+    /// @brief Store the serialized decision for a contest, replacing any previous one
+    void put(QByteArray contestId, QByteArray decision);
+    /// @brief Forget the decision for a contest
+    void remove(QByteArray contestId);
+
+    /// @brief Append any pending changes to the log now
+    void flush();
+    /// @brief Rewrite the log with only the live records
+    void compact();
+
+private:
+    QString path;
+    QFile mappedFile;
+    uchar* mapping = nullptr;
+    // Live records. Values are either views into the mapping or owned copies of records written since it was mapped.
+    QHash<QByteArray, QByteArray> records;
+    QHash<QByteArray, QByteArray> pending;
+    qint64 logSize = 0;
+    // Set when the log has a bad header or a partial record at its end, so it must be rewritten rather than appended to
+    bool damaged = false;
+    QTimer flushTimer;
+
+    void load();
+    qint64 liveSize() const;
+    static QByteArray encodeRecord(const QByteArray& key, const QByteArray& value);
+};
+
+} // namespace swv
+
+#endif // DECISIONSTORE_HPP
@@ -18,26 +18,80 @@
 
 #include "PromiseConverter.hpp"
 
-PromiseConverter::PromiseConverter(kj::TaskSet& tasks, QObject* parent)
+namespace {
+PromiseConverter::Counters promiseCounters;
+
+// A Promise which keeps the live count up to date
+class CountedPromise : public Promise {
+public:
+    CountedPromise(QObject* parent)
+        : Promise(parent) {
+        ++promiseCounters.created;
+        ++promiseCounters.live;
+    }
+    virtual ~CountedPromise() {
+        --promiseCounters.live;
+    }
+};
+}
+
+PromiseConverter::PromiseConverter(swv::MonitoredTaskSet& tasks, QObject* parent)
     : QObject(parent),
       tasks(tasks)
 {}
 
-Promise* PromiseConverter::convert(kj::Promise<void> promise)
+PromiseConverter::~PromiseConverter() noexcept
+{}
+
+Promise* PromiseConverter::convert(kj::Promise<void> promise, swv::Tracer::Context trace)
 {
-    auto result = new Promise(this);
+    auto result = createPromise();
 
     auto responsePromise = promise.then(
-                [result]() {
-        result->resolve({});
-        QQmlEngine::setObjectOwnership(result, QQmlEngine::JavaScriptOwnership);
-    }, [result](kj::Exception&& exception) {
-        result->reject({QString::fromStdString(exception.getDescription())});
-        QQmlEngine::setObjectOwnership(result, QQmlEngine::JavaScriptOwnership);
-        if (!result->hasRejectHandler())
-            throw exception;
+                [this, result, trace]() {
+        settle(result, QVariantList(), trace);
+    }, [this, result](kj::Exception&& exception) {
+        settle(result, kj::mv(exception));
     });
     tasks.add(kj::mv(responsePromise));
 
     return result;
 }
+
+const PromiseConverter::Counters& PromiseConverter::counters()
+{
+    return promiseCounters;
+}
+
+Promise* PromiseConverter::createPromise()
+{
+    ++promiseCounters.pending;
+    return new CountedPromise(this);
+}
+
+void PromiseConverter::settle(Promise* promise, const QVariantList& results, swv::Tracer::Context trace)
+{
+    // Resolving runs the QML handlers, so this span is the time spent in JavaScript
+    auto span = swv::Tracer::begin("PromiseConverter::settle", trace);
+    promise->resolve(results);
+    span.end();
+    release(promise);
+}
+
+void PromiseConverter::settle(Promise* promise, kj::Exception&& exception)
+{
+    promise->reject({QString::fromStdString(exception.getDescription())});
+    auto handled = promise->hasRejectHandler();
+    release(promise);
+    if (!handled)
+        throw exception;
+}
+
+void PromiseConverter::release(Promise* promise)
+{
+    --promiseCounters.pending;
+
+    // QML may still hold it, so leave it to the garbage collector. It must be unparented for the collector to delete it.
+    promise->setParent(nullptr);
+    QQmlEngine::setObjectOwnership(promise, QQmlEngine::JavaScriptOwnership);
+}
@@ -22,18 +22,22 @@
 #include <kj/async.h>
 #include <kj/debug.h>
 
+#include <capnp/capability.h>
+
 #include <QObject>
 #include <QQmlEngine>
 
 #include "Promise.hpp"
 
+#include <LoopMonitor.hpp>
+#include <Tracer.hpp>
+
 /**
  * @brief The PromiseConverter class converts kj::Promise objects to QML-friendly Promise objects.
  *
- * The Promise objects created by PromiseConverter are parented to the PromiseConverter initially, as they must not be
- * deleted prior to resolution; however, once the promise resolves it is set to have JavaScript Ownership so it can be
- * garbage collected by the QML runtime. The Promise remains parented to the converter, so if the QML runtime never
- * garbage collects the Promise, it will be deleted when the PromiseWrapper is deleted.
+ * The Promise objects created by PromiseConverter are parented to the PromiseConverter, as they must not be deleted
+ * prior to resolution. Once the promise settles, it is unparented and set to have JavaScript ownership, so the QML
+ * runtime garbage collects it when nothing refers to it any longer.
  *
  * If the promise is broken, the converted Promise will also break. If the converted Promise does not have a rejection
  * handler, the exception will be propagated to the TaskSet provided to the constructor. Either way, the returned
@@ -43,13 +47,14 @@ class PromiseConverter : public QObject
 {
     Q_OBJECT
 public:
-    explicit PromiseConverter(kj::TaskSet& tasks, QObject *parent = 0);
-    virtual ~PromiseConverter() noexcept {}
+    explicit PromiseConverter(swv::MonitoredTaskSet& tasks, QObject *parent = 0);
+    virtual ~PromiseConverter() noexcept;
 
     /**
      * @brief Convert a kj promise to a QML-friendly promise
      * @param promise The promise to convert
      * @param TConverter A callable taking a T as an argument and returning a QVariantList
+     * @param trace The span the promise's work belongs to, if any; settling the returned Promise is traced as its child
      * @return A Promise which fulfills or breaks with the provided promise
      * @tparam PromisedType The type the kj promise resolves to
      *
@@ -60,32 +65,48 @@ public:
      * for it to be meaningful to QML. TConverter effects this conversion.
      */
     template<typename PromisedType, typename Func>
-    Promise* convert(kj::Promise<PromisedType> promise, Func TConverter);
-    Promise* convert(kj::Promise<void> promise);
+    Promise* convert(kj::Promise<PromisedType> promise, Func TConverter, swv::Tracer::Context trace = {});
+    Promise* convert(kj::Promise<void> promise, swv::Tracer::Context trace = {});
 
     /// @brief Take a promise and ensure it completes or report the failure, but do not convert it
     void adopt(kj::Promise<void>&& promise) {
         tasks.add(kj::mv(promise));
     }
 
+    /// Counters of the Promise objects created by all PromiseConverters, for diagnostics
+    struct Counters {
+        /// Promise objects allocated
+        quint64 created = 0;
+        /// Promise objects currently allocated, whether pending or awaiting garbage collection
+        int live = 0;
+        /// Promise objects which have not yet settled
+        int pending = 0;
+    };
+    static const Counters& counters();
+
 private:
-    kj::TaskSet& tasks;
+    swv::MonitoredTaskSet& tasks;
+
+    /// @brief Create a pending Promise
+    Promise* createPromise();
+    /// @brief Resolve promise and release it
+    void settle(Promise* promise, const QVariantList& results, swv::Tracer::Context trace);
+    /// @brief Reject promise and release it. Rethrows exception if the promise has no rejection handler.
+    void settle(Promise* promise, kj::Exception&& exception);
+    /// @brief Hand a settled promise to the QML runtime
+    void release(Promise* promise);
 };
 
 template<typename T, typename Func>
-Promise* PromiseConverter::convert(kj::Promise<T> promise, Func TConverter)
+Promise* PromiseConverter::convert(kj::Promise<T> promise, Func TConverter, swv::Tracer::Context trace)
 {
-    auto result = new Promise(this);
+    auto result = createPromise();
 
     auto responsePromise = promise.then(
-        [result, TConverter](T&& results) {
-            result->resolve(TConverter(kj::mv(results)));
-            QQmlEngine::setObjectOwnership(result, QQmlEngine::JavaScriptOwnership);
-        }, [result](kj::Exception&& exception) {
-            result->reject({QString::fromStdString(exception.getDescription())});
-            QQmlEngine::setObjectOwnership(result, QQmlEngine::JavaScriptOwnership);
-            if (!result->hasRejectHandler())
-                throw exception;
+        [this, result, TConverter, trace](T&& results) {
+            settle(result, TConverter(kj::mv(results)), trace);
+        }, [this, result](kj::Exception&& exception) {
+            settle(result, kj::mv(exception));
         });
     tasks.add(kj::mv(responsePromise));
 
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResponseCache.hpp"
+
+#include <kj/debug.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+
+namespace swv {
+
+const static char CACHE_MAGIC[4] = {'S', 'W', 'V', 'C'};
+const static int FLUSH_DELAY_MS = 2000;
+
+// Keys are padded so that the message following them stays word-aligned for in-place reading
+static quint64 padToWord(quint64 size) {
+    return (size + sizeof(capnp::word) - 1) & ~quint64(sizeof(capnp::word) - 1);
+}
+
+ResponseCache::ResponseCache(QString path, QObject* parent)
+    : QObject(parent),
+      path(path),
+      file(std::make_shared<QFile>())
+{
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&flushTimer, &QTimer::timeout, this, &ResponseCache::flush);
+
+    load();
+}
+
+ResponseCache::~ResponseCache() noexcept
+{
+    flush();
+}
+
+QString ResponseCache::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/responses.cache");
+}
+
+void ResponseCache::flush()
+{
+    flushTimer.stop();
+    if (!dirty)
+        return;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    // Write a new file and swap it in; the old file stays mapped until the last value read from it is released. On
+    // platforms which can't replace a mapped file the commit fails and we keep the old cache.
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        KJ_LOG(WARNING, "Unable to open response cache for writing", path.toStdString(),
+               out.errorString().toStdString());
+        return;
+    }
+
+    static const char padding[sizeof(capnp::word)] = {};
+    FileHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& pair : entries) {
+        const auto& key = pair.first.second;
+        auto words = pair.second.words.asBytes();
+        RecordHeader record{pair.first.first, quint32(key.size()), pair.second.words.size()};
+        out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        out.write(key);
+        out.write(padding, padToWord(key.size()) - key.size());
+        out.write(reinterpret_cast<const char*>(words.begin()), words.size());
+    }
+
+    if (out.commit())
+        dirty = false;
+    else
+        KJ_LOG(WARNING, "Unable to write response cache", path.toStdString(), out.errorString().toStdString());
+}
+
+void ResponseCache::load()
+{
+    file->setFileName(path);
+    if (!file->open(QIODevice::ReadOnly))
+        return;
+
+    quint64 fileSize = file->size();
+    if (fileSize < sizeof(FileHeader))
+        return;
+    auto mapping = file->map(0, fileSize);
+    if (mapping == nullptr) {
+        KJ_LOG(WARNING, "Unable to map response cache", path.toStdString(), file->errorString().toStdString());
+        return;
+    }
+
+    auto header = reinterpret_cast<const FileHeader*>(mapping);
+    if (std::memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 || header->version != FORMAT_VERSION) {
+        KJ_LOG(INFO, "Discarding response cache from another format version", path.toStdString());
+        return;
+    }
+
+    quint64 offset = sizeof(FileHeader);
+    while (fileSize - offset >= sizeof(RecordHeader)) {
+        auto record = reinterpret_cast<const RecordHeader*>(mapping + offset);
+        offset += sizeof(RecordHeader);
+
+        auto keyBytes = padToWord(record->keySize);
+        if (keyBytes > fileSize - offset ||
+                record->wordCount > (fileSize - offset - keyBytes) / sizeof(capnp::word)) {
+            KJ_LOG(WARNING, "Response cache is truncated; ignoring the remainder", path.toStdString(), offset);
+            break;
+        }
+
+        QByteArray key(reinterpret_cast<const char*>(mapping + offset), record->keySize);
+        offset += keyBytes;
+        auto& entry = entries[Key(record->kind, key)];
+        entry.words = kj::arrayPtr(reinterpret_cast<const capnp::word*>(mapping + offset), record->wordCount);
+        offset += record->wordCount * sizeof(capnp::word);
+    }
+
+    // The file records no usage, so start with every value equally recent
+    for (auto itr = entries.begin(); itr != entries.end(); ++itr) {
+        itr->second.recency = recentlyUsed.insert(recentlyUsed.end(), itr->first);
+        size += entrySize(itr->first, itr->second);
+    }
+    evict();
+
+    KJ_LOG(DBG, "Loaded response cache", path.toStdString(), entries.size());
+}
+
+std::shared_ptr<ResponseCache::Value> ResponseCache::openValue(Kind kind, const QByteArray& key)
+{
+    auto itr = entries.find(Key(quint32(kind), key));
+    if (itr == entries.end())
+        return nullptr;
+
+    auto& entry = itr->second;
+    if (entry.value == nullptr) {
+        entry.value = std::make_shared<Value>();
+        entry.value->mapping = file;
+    }
+    if (entry.value->reader == nullptr) {
+        try {
+            entry.value->reader = kj::heap<capnp::FlatArrayMessageReader>(entry.words);
+        } catch (kj::Exception& e) {
+            KJ_LOG(WARNING, "Discarding corrupt response cache entry", e);
+            size -= entrySize(itr->first, entry);
+            recentlyUsed.erase(entry.recency);
+            entries.erase(itr);
+            dirty = true;
+            return nullptr;
+        }
+    }
+    recentlyUsed.splice(recentlyUsed.end(), recentlyUsed, entry.recency);
+    return entry.value;
+}
+
+void ResponseCache::store(Kind kind, QByteArray key, kj::Array<capnp::word> words)
+{
+    auto itr = entries.find(Key(quint32(kind), key));
+    if (itr == entries.end()) {
+        itr = entries.emplace(Key(quint32(kind), key), Entry()).first;
+        itr->second.recency = recentlyUsed.insert(recentlyUsed.end(), itr->first);
+    } else {
+        auto& entry = itr->second;
+        recentlyUsed.splice(recentlyUsed.end(), recentlyUsed, entry.recency);
+        // Revalidation usually finds the value unchanged; don't rewrite the cache for that
+        if (entry.words.size() == words.size() &&
+                std::memcmp(entry.words.begin(), words.begin(), words.asBytes().size()) == 0)
+            return;
+        size -= entrySize(itr->first, entry);
+    }
+
+    // Handles to the old value keep it alive; it is freed when the last of them is released
+    auto& entry = itr->second;
+    entry.words = kj::arrayPtr(static_cast<const capnp::word*>(words.begin()), words.size());
+    entry.value = std::make_shared<Value>();
+    entry.value->ownedWords = kj::mv(words);
+    size += entrySize(itr->first, entry);
+    evict();
+
+    dirty = true;
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void ResponseCache::evict()
+{
+    // Always keep the most recent value, even if it alone exceeds the bound
+    while (size > MAXIMUM_SIZE && recentlyUsed.size() > 1) {
+        auto itr = entries.find(recentlyUsed.front());
+        size -= entrySize(itr->first, itr->second);
+        entries.erase(itr);
+        recentlyUsed.pop_front();
+        dirty = true;
+    }
+}
+
+quint64 ResponseCache::entrySize(const Key& key, const Entry& entry)
+{
+    return sizeof(RecordHeader) + padToWord(key.second.size()) + entry.words.size() * sizeof(capnp::word);
+}
+
+} // namespace swv
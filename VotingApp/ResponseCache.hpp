@@ -0,0 +1,153 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESPONSECACHE_HPP
+#define RESPONSECACHE_HPP
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+
+#include <list>
+#include <map>
+#include <memory>
+
+namespace swv {
+
+/**
+ * @brief The ResponseCache class is a versioned on-disk cache of serialized Cap'n Proto structs
+ *
+ * The cache stores values such as contests and coin details, keyed by their kind and ID, so that the UI can render
+ * them immediately on startup and revalidate them from the network in the background. The cache file is memory-mapped
+ * when the cache is constructed, and cached values are read in place, without copying or parsing the file.
+ *
+ * A value returned by @ref get stays readable for as long as its Cached handle, or a copy of the handle's keepAlive, is
+ * held, even if the value is subsequently replaced with @ref put or evicted, or the cache is destroyed. The memory
+ * behind a replaced or evicted value is freed as soon as the last such handle is released.
+ *
+ * The cache is bounded to MAXIMUM_SIZE bytes of values; when a @ref put exceeds that, the least recently used values
+ * are evicted. Changes are written back to disk shortly after they are made, and when the cache is destroyed.
+ */
+class ResponseCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Kind : quint32 {
+        Contest = 1,
+        CoinDetails = 2
+    };
+    /// Bump whenever a cached schema changes incompatibly; cache files written with another version are discarded
+    static constexpr quint32 FORMAT_VERSION = 1;
+    /// Bound on the size of the cached values, and thus roughly on the size of the cache file
+    static constexpr quint64 MAXIMUM_SIZE = 8 << 20;
+
+    /// A cached value; reader remains valid for as long as keepAlive (or a copy of it) is held
+    template <typename T>
+    struct Cached {
+        typename T::Reader reader;
+        std::shared_ptr<const void> keepAlive;
+    };
+
+    explicit ResponseCache(QString path = defaultPath(), QObject* parent = nullptr);
+    virtual ~ResponseCache() noexcept;
+
+    /// @brief Get the location of the cache file in the platform's cache directory
+    static QString defaultPath();
+
+    /**
+     * @brief Get a cached value
+     * @param kind The kind of value to get
+     * @param key The ID of the value
+     * @return The cached value, or null if it is not cached
+     */
+    template <typename T>
+    kj::Maybe<Cached<T>> get(Kind kind, QByteArray key);
+    /**
+     * @brief Cache a value, replacing any value previously cached with the same kind and key
+     * @param kind The kind of value to store
+     * @param key The ID of the value
+     * @param value The value to store; it is copied into the cache
+     */
+    template <typename T>
+    void put(Kind kind, QByteArray key, typename T::Reader value);
+
+    /// @brief Write any changes to disk now
+    void flush();
+
+private:
+    struct FileHeader {
+        char magic[4];
+        quint32 version;
+    };
+    struct RecordHeader {
+        quint32 kind;
+        quint32 keySize;
+        quint64 wordCount;
+    };
+    // The storage behind a value: either a view into the mapped file, which it keeps mapped, or words of its own
+    struct Value {
+        std::shared_ptr<QFile> mapping;
+        kj::Array<capnp::word> ownedWords;
+        kj::Own<capnp::FlatArrayMessageReader> reader;
+    };
+    using Key = QPair<quint32, QByteArray>;
+    struct Entry {
+        kj::ArrayPtr<const capnp::word> words;
+        // Shared with the Cached handles given out. Values read from the file are only created when first read.
+        std::shared_ptr<Value> value;
+        // Position in recentlyUsed
+        std::list<Key>::iterator recency;
+    };
+
+    QString path;
+    std::shared_ptr<QFile> file;
+    std::map<Key, Entry> entries;
+    // Keys of the entries, least recently used first
+    std::list<Key> recentlyUsed;
+    quint64 size = 0;
+    QTimer flushTimer;
+    bool dirty = false;
+
+    void load();
+    std::shared_ptr<Value> openValue(Kind kind, const QByteArray& key);
+    void store(Kind kind, QByteArray key, kj::Array<capnp::word> words);
+    void evict();
+    static quint64 entrySize(const Key& key, const Entry& entry);
+};
+
+template <typename T>
+kj::Maybe<ResponseCache::Cached<T>> ResponseCache::get(Kind kind, QByteArray key) {
+    if (auto value = openValue(kind, key))
+        return Cached<T>{value->reader->template getRoot<T>(), kj::mv(value)};
+    return nullptr;
+}
+
+template <typename T>
+void ResponseCache::put(Kind kind, QByteArray key, typename T::Reader value) {
+    capnp::MallocMessageBuilder message;
+    message.setRoot(value);
+    store(kind, kj::mv(key), capnp::messageToFlatArray(message));
+}
+
+} // namespace swv
+
+#endif // RESPONSECACHE_HPP
@@ -20,7 +20,11 @@
 #include <kj/common.h>
 
 #include <QDebug>
+#include <QFile>
 #include <QQmlEngine>
+#include <QTimer>
+#include <QSet>
+#include <QHash>
 
 #include "VotingSystem.hpp"
 #include "wrappers/Coin.hpp"
@@ -31,8 +35,12 @@
 #include "wrappers/OwningWrapper.hpp"
 #include "wrappers/Converters.hpp"
 #include "wrappers/ChainAdaptorWrapper.hpp"
+#include "wrappers/ContestGeneratorWrapper.hpp"
+#include "ContestFeedModel.hpp"
 #include "Promise.hpp"
 #include "PromiseConverter.hpp"
+#include "ResponseCache.hpp"
+#include "DecisionStore.hpp"
 #include "TwoPartyClient.hpp"
 
 #include "capnqt/QSocketWrapper.hpp"
@@ -41,13 +49,24 @@
 #include <capnp/serialize-packed.h>
 
 #include <StubChainAdaptor.hpp>
+#include <Tracer.hpp>
+#include <LoopMonitor.hpp>
+#include <ProcessStats.hpp>
+
+#include <memory>
+#include <random>
 
 namespace swv {
 
-const static QString PENDING_DECISIONS = QStringLiteral("pendingDecisions");
-const static QString PENDING_DECISION = QStringLiteral("pendingDecisions/%1");
-const static QString OPINIONS = QStringLiteral("pendingDecisions/%1/opinions");
-const static QString WRITEINS = QStringLiteral("pendingDecisions/%1/writeins");
+// Reconnection backoff: the first retry comes after at most half a second, doubling up to half a minute
+const static int RECONNECT_BASE_DELAY_MS = 500;
+const static int RECONNECT_MAX_DELAY_MS = 30000;
+// Accounts holding this many balances in a contest's coin are offered consolidation before voting
+const static int DEFAULT_CONSOLIDATION_THRESHOLD = 4;
+
+static QByteArray coinCacheKey(quint64 coinId) {
+    return QByteArray::number(coinId);
+}
 
 class VotingSystemPrivate : private kj::TaskSet::ErrorHandler {
     Q_DISABLE_COPY(VotingSystemPrivate)
@@ -56,41 +75,136 @@ class VotingSystemPrivate : private kj::TaskSet::ErrorHandler {
 public:
     VotingSystemPrivate(VotingSystem* q_ptr)
         : q_ptr(q_ptr),
-          tasks(*this),
+          tasks(*this, "VotingSystem"),
           promiseConverter(kj::heap<PromiseConverter>(tasks)),
-          adaptor(kj::heap<ChainAdaptorWrapper>(*promiseConverter)),
-          socket(kj::heap<QTcpSocket>())
+          cache(kj::heap<ResponseCache>()),
+          decisionStore(kj::heap<DecisionStore>()),
+          adaptor(kj::heap<ChainAdaptorWrapper>(*promiseConverter, *cache, *decisionStore)),
+          socket(kj::heap<QTcpSocket>()),
+          random(std::random_device()())
     {
         // Funky syntax is because QAbstractSocket::error is overloaded.
         // See: http://lists.qt-project.org/pipermail/interest/2013-November/009885.html
         QObject::connect(socket,
                          static_cast<void (QTcpSocket::*)(QAbstractSocket::SocketError)>(&QTcpSocket::error),
                          q_ptr, [this](QAbstractSocket::SocketError e) {socketError(e);});
+
+        reconnectTimer.setSingleShot(true);
+        QObject::connect(&reconnectTimer, &QTimer::timeout, q_ptr, [this] {attemptReconnect();});
     }
     virtual ~VotingSystemPrivate() noexcept
     {}
 
     VotingSystem* q_ptr;
     QString lastError;
-    kj::TaskSet tasks;
+    MonitoredTaskSet tasks;
     kj::Own<PromiseConverter> promiseConverter;
+    kj::Own<ResponseCache> cache;
+    kj::Own<DecisionStore> decisionStore;
     kj::Own<ChainAdaptorWrapper> adaptor;
     kj::Own<TwoPartyClient> client;
     kj::Own<BackendWrapper> backend;
     kj::Own<QTcpSocket> socket;
     kj::Own<QSocketWrapper> socketWrapper;
     kj::Array<::Coin::Reader> kjCoins;
+    // Indexes over m_coins and m_myAccounts for the lookups QML makes per delegate. Wherever those models are appended
+    // to or cleared, these must be updated to match.
+    QHash<quint64, CoinWrapper*> coinsById;
+    QHash<QString, CoinWrapper*> coinsByName;
+    QHash<QString, data::Account*> accountsByName;
+    QSet<quint64> volumeHistoryRequests;
     swv::data::Account* currentAccount = nullptr;
+    int consolidationThreshold = DEFAULT_CONSOLIDATION_THRESHOLD;
+
+    // Connection manager state. The endpoint is remembered so that a lost connection can be re-established.
+    QString hostname;
+    quint16 port = 0;
+    bool reconnecting = false;
+    int reconnectAttempts = 0;
+    QTimer reconnectTimer;
+    QMetaObject::Connection reconnectConnection;
+    std::mt19937 random;
 
     void completeConnection(Promise* connectionPromise) {
         Q_Q(VotingSystem);
 
         socketWrapper = kj::heap<QSocketWrapper>(*socket);
         client = kj::heap<TwoPartyClient>(*socketWrapper);
-        backend = kj::heap<BackendWrapper>(client->bootstrap().castAs<Backend>(), *promiseConverter);
+        auto bootstrap = client->bootstrap().castAs<Backend>();
+        if (backend)
+            // Re-bootstrap into the existing wrapper; generators and parked requests pick the new client up from it
+            backend->setBackend(kj::mv(bootstrap));
+        else
+            backend = kj::heap<BackendWrapper>(kj::mv(bootstrap), *promiseConverter);
+        reconnecting = false;
+        reconnectAttempts = 0;
         emit q->backendConnectedChanged(true);
-        connectionPromise->resolve({});
-        QQmlEngine::setObjectOwnership(connectionPromise, QQmlEngine::JavaScriptOwnership);
+
+        if (connectionPromise) {
+            connectionPromise->resolve({});
+            QQmlEngine::setObjectOwnership(connectionPromise, QQmlEngine::JavaScriptOwnership);
+        }
+    }
+
+    /// Get the current account's balances in the contest's coin. The current account must be set.
+    kj::Promise<kj::Array<::Balance::Reader>> getVotingBalances(ContestWrapper* contest) {
+        auto coinId = contest->getCoin();
+        return adaptor->adaptor()->getBalancesForOwner(currentAccount->get_name()).then(
+                    [coinId](kj::Array<::Balance::Reader> balances) {
+            auto newEnd = std::remove_if(balances.begin(), balances.end(), [coinId](::Balance::Reader b) {
+                return b.getType() != coinId;
+            });
+            return kj::heapArray<::Balance::Reader>(balances.begin(), newEnd);
+        });
+    }
+
+    /// Fetch fresh details for all coins from the backend, updating the coin wrappers and the cache
+    void refreshCoinDetails() {
+        Q_Q(VotingSystem);
+
+        // One request for all coins, without volume history; that is fetched per coin, only when it's displayed
+        auto span = Tracer::begin("VotingSystem::refreshCoinDetails");
+        auto request = backend->backend().getCoinsDetailsRequest();
+        auto coinIds = KJ_MAP(coin, kjCoins) { return coin.getId(); };
+        request.setCoinIds(coinIds);
+        span.propagate(request.initTrace());
+
+        promiseConverter->adopt(request.send().then([this, q, coinIds = kj::mv(coinIds)](
+                                                    capnp::Response<Backend::GetCoinsDetailsResults> r) {
+            auto details = r.getDetails();
+            for (uint i = 0; i < details.size() && i < coinIds.size(); ++i) {
+                cache->put<Backend::CoinDetails>(ResponseCache::Kind::CoinDetails, coinCacheKey(coinIds[i]),
+                                                 details[i]);
+                if (auto wrapper = q->getCoin(coinIds[i]))
+                    wrapper->updateFields(details[i]);
+            }
+        }).attach(kj::mv(span)));
+    }
+
+    void scheduleReconnect() {
+        if (hostname.isEmpty())
+            return;
+
+        // Exponential backoff with equal jitter: wait between half and all of the backoff, so that clients which lost
+        // the server at the same moment don't all come back at the same moment
+        auto ceiling = std::min<qint64>(RECONNECT_MAX_DELAY_MS,
+                                        qint64(RECONNECT_BASE_DELAY_MS) << std::min(reconnectAttempts, 16));
+        auto delay = std::uniform_int_distribution<int>(ceiling / 2, ceiling)(random);
+        ++reconnectAttempts;
+        reconnecting = true;
+
+        KJ_LOG(INFO, "Scheduling reconnection to backend", reconnectAttempts, delay);
+        reconnectTimer.start(delay);
+    }
+
+    void attemptReconnect() {
+        QObject::disconnect(reconnectConnection);
+        reconnectConnection = QObject::connect(socket, &QTcpSocket::connected, q_ptr, [this] {
+            QObject::disconnect(reconnectConnection);
+            completeConnection(nullptr);
+        });
+        socket->abort();
+        socket->connectToHost(hostname, port);
     }
 
     void socketError(QAbstractSocket::SocketError errorCode)
@@ -100,18 +214,26 @@ public:
         qDebug() << errorCode;
         if (socket)
             qDebug() << socket->errorString();
-        if (q->backendConnected())
+
+        if (reconnecting) {
+            // A reconnection attempt failed. The user has already been told the connection was lost; just try again.
+            KJ_LOG(INFO, "Reconnection attempt failed", socket->errorString().toStdString());
+            QObject::disconnect(reconnectConnection);
+            scheduleReconnect();
+            return;
+        }
+        if (q->backendConnected()) {
+            q->setLastError(QObject::tr("Connection to server has encountered an error: %1. Reconnecting...")
+                            .arg(socket->errorString()));
             q->disconnected();
+            return;
+        }
 
         if (errorCode == QAbstractSocket::HostNotFoundError) {
             q->setLastError(QObject::tr("Unable to find Follow My Vote server. Is the voting application up to date?"));
             return;
         }
-        if (!q->backendConnected()) {
-            q->setLastError(QObject::tr("Unable to connect to Follow My Vote server: %1").arg(socket->errorString()));
-            return;
-        }
-        q->setLastError(QObject::tr("Connection to server has encountered an error: %1").arg(socket->errorString()));
+        q->setLastError(QObject::tr("Unable to connect to Follow My Vote server: %1").arg(socket->errorString()));
     }
 
 private:
@@ -147,83 +269,92 @@ VotingSystem::VotingSystem(QObject *parent)
     connect(d->adaptor, &ChainAdaptorWrapper::error, this, [this](QString error) {
         setLastError(error);
     });
+    // Load the coin list as soon as the chain is available, rendering cached details without waiting for the backend
+    connect(this, &VotingSystem::adaptorReadyChanged, this, [this, d](bool adaptorReady) {
+        if (!adaptorReady)
+            return;
+
+        d->promiseConverter->adopt(d->adaptor->adaptor()->listAllCoins().then(
+                                      [this, d](kj::Array<::Coin::Reader> coins) {
+            for (int i = 0; i < m_coins->count(); ++i)
+                m_coins->get(i)->deleteLater();
+            m_coins->clear();
+            d->coinsById.clear();
+            d->coinsByName.clear();
+            d->kjCoins = kj::mv(coins);
+
+            for (auto coin : d->kjCoins) {
+                auto wrapper = new CoinWrapper(this);
+                wrapper->updateFields(coin);
+                KJ_IF_MAYBE(details, d->cache->get<Backend::CoinDetails>(ResponseCache::Kind::CoinDetails,
+                                                                         coinCacheKey(coin.getId())))
+                    wrapper->updateFields(details->reader);
+                m_coins->append(wrapper);
+                d->coinsById.insert(wrapper->get_coinId(), wrapper);
+                // Like the scan this replaces, name lookups find the first coin by that name
+                if (!d->coinsByName.contains(wrapper->get_name()))
+                    d->coinsByName.insert(wrapper->get_name(), wrapper);
+            }
+
+            if (backendConnected())
+                d->refreshCoinDetails();
+        }));
+
+        // Get my accounts, populate property. These come from the chain, so needn't wait for the backend either.
+        using BalanceList = kj::Array<::Balance::Reader>;
+        d->promiseConverter->adopt(d->adaptor->adaptor()->getMyAccounts().then(
+                                       [this, d](kj::Array<QString> accountNames) {
+            // Get balances for each account
+            auto accounts = kj::heapArrayBuilder<kj::Promise<std::tuple<QString,
+                                                                        BalanceList>>>(accountNames.size());
+            for (QString name : accountNames)
+                accounts.add(d->adaptor->adaptor()->getBalancesForOwner(name).then([name](BalanceList bals) {
+                                 return std::make_tuple(name, kj::mv(bals));
+                             }));
+            return kj::joinPromises(accounts.finish());
+        }).then([this, d](kj::Array<std::tuple<QString, BalanceList>> accountsBalances) {
+            // Get the persisted current account name, if any
+            auto currentAccountName = QSettings().value("currentAccount").toString();
+
+            // Create Account object with AccountBalances populated, add them to myAccounts list
+            for (auto& tuple : accountsBalances) {
+                QString name;
+                BalanceList balances;
+                std::tie(name, balances) = kj::mv(tuple);
+
+                auto account = new data::Account(this);
+                account->update_name(name);
+
+                // Sum up balances by coin ID
+                std::map<quint64, qint64> balanceSums;
+                for (Balance::Reader balance : balances)
+                    balanceSums[balance.getType()] += balance.getAmount();
+                // Store balance sums in Account object
+                for (auto balPair : balanceSums) {
+                    data::AccountBalance balance{balPair.first, balPair.second};
+                    account->get_balances()->append(QVariant::fromValue(balance));
+                }
+
+                m_myAccounts->append(account);
+                if (!d->accountsByName.contains(name))
+                    d->accountsByName.insert(name, account);
+                // If this account is the persisted current account, set that too
+                if (account->get_name() == currentAccountName)
+                    setCurrentAccount(account);
+                // If no account is set yet, go ahead and set the first one we find (we should set a current
+                // account at startup if at all possible)
+                else if (d->currentAccount == nullptr)
+                    setCurrentAccount(account);
+            }
+        }));
+    });
     connect(this, &VotingSystem::isReadyChanged, this, [this, d] {
         if (isReady()) {
             emit ready();
 
-            // Fetch coin list, populate property
-            d->promiseConverter->adopt(d->adaptor->adaptor()->listAllCoins().then(
-                                          [this, d](kj::Array<::Coin::Reader> coins) {
-                for (int i = 0; i < m_coins->count(); ++i)
-                    m_coins->get(i)->deleteLater();
-                m_coins->clear();
-                d->kjCoins = kj::mv(coins);
-
-                // For each coin, fetch the statistics and return a promise for the coin and statistics
-                return kj::joinPromises(KJ_MAP(coin, d->kjCoins) {
-                         auto request = d->backend->backend().getCoinDetailsRequest();
-                         request.setCoinId(coin.getId());
-                         // Get one week of volume history
-                         request.setVolumeHistoryLength(24 * 7);
-                         return request.send().then([coin](capnp::Response<Backend::GetCoinDetailsResults> r) {
-                             return std::make_tuple(coin, kj::mv(r));
-                         });
-                     });
-            }).then([this, d](kj::Array<std::tuple<Coin::Reader, capnp::Response<Backend::GetCoinDetailsResults>>> r) {
-                // Create wrappers for the coins with statistics set
-                for (const auto& tuple : r) {
-                    auto wrapper = new CoinWrapper(this);
-                    wrapper->updateFields(std::get<0>(tuple));
-                    wrapper->updateFields(std::get<1>(tuple).getDetails());
-                    m_coins->append(wrapper);
-                }
-            }));
-
-            // Get my accounts, populate property
-            using BalanceList = kj::Array<::Balance::Reader>;
-            d->promiseConverter->adopt(d->adaptor->adaptor()->getMyAccounts().then(
-                                           [this, d](kj::Array<QString> accountNames) {
-                // Get balances for each account
-                auto accounts = kj::heapArrayBuilder<kj::Promise<std::tuple<QString,
-                                                                            BalanceList>>>(accountNames.size());
-                for (QString name : accountNames)
-                    accounts.add(d->adaptor->adaptor()->getBalancesForOwner(name).then([name](BalanceList bals) {
-                                     return std::make_tuple(name, kj::mv(bals));
-                                 }));
-                return kj::joinPromises(accounts.finish());
-            }).then([this, d](kj::Array<std::tuple<QString, BalanceList>> accountsBalances) {
-                // Get the persisted current account name, if any
-                auto currentAccountName = QSettings().value("currentAccount").toString();
-
-                // Create Account object with AccountBalances populated, add them to myAccounts list
-                for (auto& tuple : accountsBalances) {
-                    QString name;
-                    BalanceList balances;
-                    std::tie(name, balances) = kj::mv(tuple);
-
-                    auto account = new data::Account(this);
-                    account->update_name(name);
-
-                    // Sum up balances by coin ID
-                    std::map<quint64, qint64> balanceSums;
-                    for (Balance::Reader balance : balances)
-                        balanceSums[balance.getType()] += balance.getAmount();
-                    // Store balance sums in Account object
-                    for (auto balPair : balanceSums) {
-                        data::AccountBalance balance{balPair.first, balPair.second};
-                        account->get_balances()->append(QVariant::fromValue(balance));
-                    }
-
-                    m_myAccounts->append(account);
-                    // If this account is the persisted current account, set that too
-                    if (account->get_name() == currentAccountName)
-                        setCurrentAccount(account);
-                    // If no account is set yet, go ahead and set the first one we find (we should set a current
-                    // account at startup if at all possible)
-                    else if (d->currentAccount == nullptr)
-                        setCurrentAccount(account);
-                }
-            }));
+            // Revalidate coin details. If the coin list is still loading, it will do this itself when it's done.
+            if (d->kjCoins.size() > 0)
+                d->refreshCoinDetails();
         }
     });
 }
@@ -242,7 +373,7 @@ bool VotingSystem::isReady() const {
 
 bool VotingSystem::backendConnected() const {
     Q_D(const VotingSystem);
-    return bool(d->backend);
+    return d->backend && d->backend->isConnected();
 }
 
 bool VotingSystem::adaptorReady() const {
@@ -269,6 +400,14 @@ Promise* VotingSystem::connectToBackend(QString hostname, quint16 port) {
 
     Promise* connectPromise = new Promise(this);
 
+    // An explicit connection supersedes any automatic reconnection in progress
+    d->reconnectTimer.stop();
+    QObject::disconnect(d->reconnectConnection);
+    d->reconnecting = false;
+    d->reconnectAttempts = 0;
+    d->hostname = hostname;
+    d->port = port;
+
     // I want this connection to be destroyed as soon as it fires for the first time... The best/safest way I can think
     // of to do this is with a shared pointer.
     auto connection = std::make_shared<QMetaObject::Connection>();
@@ -330,14 +469,9 @@ Promise* VotingSystem::castCurrentDecision(swv::ContestWrapper* contest) {
         return nullptr;
     }
 
-    // Get all balances for current account, filter out the ones in a coin other than this contest's coin
-    auto future = chain->adaptor()->getBalancesForOwner(d->currentAccount->get_name());
+    // Get all balances for current account in this contest's coin
+    auto future = d->getVotingBalances(contest);
     auto finishPromise = future.then([this, d, decision, chain, contest](kj::Array<::Balance::Reader> balances) {
-        auto newEnd = std::remove_if(balances.begin(), balances.end(), [contest](::Balance::Reader b) {
-                           return b.getType() != contest->getCoin();
-                       });
-        balances = kj::heapArray<::Balance::Reader>(balances.begin(), newEnd);
-
         if (balances.size() == 0) {
             auto coin = getCoin(contest->getCoin());
             if (coin == nullptr) {
@@ -350,46 +484,176 @@ Promise* VotingSystem::castCurrentDecision(swv::ContestWrapper* contest) {
             KJ_FAIL_REQUIRE("Couldn't cast vote because voting account has no balances in the coin");
         }
 
+        // Build the datagram once, in a message owned by this cast, and publish it on all balances at once. The
+        // adaptor copies the datagram on each publication, so concurrent casts share no state.
+        auto message = kj::heap<capnp::MallocMessageBuilder>();
+        auto dgram = message->initRoot<::Datagram>();
+        dgram.initIndex().setType(Datagram::DatagramType::DECISION);
+        dgram.getIndex().setKey(contest->getId());
         auto serialDecision = decision->serialize();
-        auto promises = kj::heapArrayBuilder<kj::Promise<void>>(balances.size());
-        for (auto balance : balances) {
-            auto dgram = chain->getNewDatagram();
-            dgram.initIndex().setType(Datagram::DatagramType::DECISION);
-            auto binaryId = QByteArray::fromHex(contest->id().toLocal8Bit());
-            dgram.getIndex().setKey(convertBlob(binaryId));
-            dgram.setContent(convertBlob(serialDecision));
-
-            promises.add(chain->adaptor()->publishDatagram(convertBlob(balance.getId())));
-        }
-
-        return kj::joinPromises(promises.finish());
+        dgram.setContent(convertBlob(serialDecision));
+        auto reader = dgram.asReader();
+
+        auto contestId = contest->id();
+        auto total = static_cast<int>(balances.size());
+        auto published = std::make_shared<int>(0);
+        emit decisionCastProgress(contestId, 0, total);
+
+        auto promises = KJ_MAP(balance, balances) {
+            auto balanceId = convertBlob(balance.getId());
+            return chain->adaptor()->publishDatagram(balanceId, balanceId, reader)
+                    .then([this, contestId, published, total] {
+                emit decisionCastProgress(contestId, ++*published, total);
+            });
+        };
+
+        return kj::joinPromises(kj::mv(promises)).attach(kj::mv(message));
     });
 
     return d->promiseConverter->convert(kj::mv(finishPromise));
 }
 
+Promise* VotingSystem::checkConsolidation(ContestWrapper* contest) {
+    Q_D(VotingSystem);
+
+    if (!isReady() || d->currentAccount == nullptr || contest == nullptr)
+        return nullptr;
+
+    return d->promiseConverter->convert(d->getVotingBalances(contest),
+                                        [d](kj::Array<::Balance::Reader> balances) -> QVariantList {
+        auto count = static_cast<int>(balances.size());
+        return {count >= d->consolidationThreshold, count};
+    });
+}
+
+Promise* VotingSystem::consolidateBalances(ContestWrapper* contest) {
+    Q_D(VotingSystem);
+
+    if (!isReady()) {
+        setLastError(tr("Unable to combine balances. Please ensure that you are online and that you have connected "
+                        "this app to the blockchain."));
+        return nullptr;
+    }
+
+    if (d->currentAccount == nullptr) {
+        setLastError(tr("Unable to combine balances because current account is not set. "
+                        "Please set your account in the settings and try again."));
+        return nullptr;
+    }
+
+    if (contest == nullptr) {
+        setLastError(tr("Oops! A bug is preventing your balances from being combined. "
+                        "(Attempted to combine balances for null contest)"));
+        return nullptr;
+    }
+
+    auto owner = d->currentAccount->get_name();
+    auto coinId = contest->getCoin();
+    auto promise = d->adaptor->adaptor()->consolidateBalances(owner, coinId).then([](::Balance::Reader) {});
+    return d->promiseConverter->convert(kj::mv(promise));
+}
+
 CoinWrapper* VotingSystem::getCoin(quint64 id)
 {
-    for (CoinWrapper* coin : m_coins->toList())
-        if (coin->get_coinId() == id)
-            return coin;
-    return nullptr;
+    Q_D(VotingSystem);
+    return d->coinsById.value(id);
 }
 
 CoinWrapper* VotingSystem::getCoin(QString name)
 {
-    for (CoinWrapper* coin : m_coins->toList())
-        if (coin->get_name() == name)
-            return coin;
-    return nullptr;
+    Q_D(VotingSystem);
+    return d->coinsByName.value(name);
 }
 
 data::Account*VotingSystem::getAccount(QString name)
 {
-    for (auto account : m_myAccounts->toList())
-        if (account->get_name() == name)
-            return account;
-    return nullptr;
+    Q_D(VotingSystem);
+    return d->accountsByName.value(name);
+}
+
+ContestFeedModel* VotingSystem::createContestFeed(ContestGeneratorWrapper* generator)
+{
+    Q_D(VotingSystem);
+
+    if (!adaptorReady()) {
+        delete generator;
+        return nullptr;
+    }
+
+    auto model = new ContestFeedModel(generator, *d->adaptor, *d->promiseConverter);
+    QQmlEngine::setObjectOwnership(model, QQmlEngine::JavaScriptOwnership);
+    connect(model, &ContestFeedModel::error, this, &VotingSystem::setLastError);
+    return model;
+}
+
+Promise* VotingSystem::loadVolumeHistory(quint64 coinId, int hours)
+{
+    Q_D(VotingSystem);
+
+    if (!backendConnected() || d->volumeHistoryRequests.contains(coinId))
+        return nullptr;
+
+    d->volumeHistoryRequests.insert(coinId);
+    auto request = d->backend->backend().getCoinDetailsRequest();
+    request.setCoinId(coinId);
+    request.setVolumeHistoryLength(hours);
+    auto promise = request.send().then([this, coinId](capnp::Response<Backend::GetCoinDetailsResults> r) {
+        if (auto coin = getCoin(coinId))
+            coin->updateFields(r.getDetails());
+    }).attach(kj::defer([d, coinId] {
+        d->volumeHistoryRequests.remove(coinId);
+    }));
+
+    return d->promiseConverter->convert(kj::mv(promise));
+}
+
+Promise* VotingSystem::exportTrace(QString path)
+{
+    Q_D(VotingSystem);
+
+    auto writeTrace = [path](const std::vector<Tracer::Process>& processes) {
+        QFile file(path);
+        KJ_REQUIRE(file.open(QIODevice::WriteOnly | QIODevice::Truncate), "Unable to open trace file",
+                   path.toStdString(), file.errorString().toStdString());
+        auto json = Tracer::chromeTrace(processes);
+        KJ_REQUIRE(file.write(json) == json.size(), "Unable to write trace file",
+                   path.toStdString(), file.errorString().toStdString());
+    };
+    // This process's spans include those recorded by the chain adaptor, as it shares our tracer through the shared library
+    Tracer::Process local{"VotingApp", Tracer::collect()};
+
+    if (!backendConnected())
+        return d->promiseConverter->convert(kj::evalLater([writeTrace, local] { writeTrace({local}); }));
+
+    auto promise = d->backend->backend().getTraceSpansRequest().send().then(
+                [writeTrace, local](capnp::Response<Backend::GetTraceSpansResults> r) {
+        // The backend's span names point into the response, so write the trace before it is released
+        writeTrace({local, {"Backend", Tracer::read(r.getSpans())}});
+    }, [writeTrace, local](kj::Exception&& e) {
+        KJ_LOG(WARNING, "Unable to get trace spans from backend; exporting local spans only", e);
+        writeTrace({local});
+    });
+    return d->promiseConverter->convert(kj::mv(promise));
+}
+
+QVariantList VotingSystem::memoryStats() const
+{
+    capnp::MallocMessageBuilder message;
+    auto stats = message.initRoot<::Stats>();
+    fillProcessStats(stats);
+
+    QVariantList result;
+    for (auto arena : stats.asReader().getArenas())
+        result.append(convertArenaStats(arena));
+    return result;
+}
+
+QVariantMap VotingSystem::loopStats() const
+{
+    capnp::MallocMessageBuilder message;
+    auto stats = message.initRoot<::Stats>();
+    fillProcessStats(stats);
+    return convertLoopStats(stats.asReader());
 }
 
 void VotingSystem::cancelCurrentDecision(ContestWrapper* contest) {
@@ -415,6 +679,33 @@ void VotingSystem::cancelCurrentDecision(ContestWrapper* contest) {
     }));
 }
 
+int VotingSystem::consolidationThreshold() const {
+    Q_D(const VotingSystem);
+    return d->consolidationThreshold;
+}
+
+void VotingSystem::setConsolidationThreshold(int consolidationThreshold) {
+    Q_D(VotingSystem);
+
+    if (d->consolidationThreshold == consolidationThreshold)
+        return;
+
+    d->consolidationThreshold = consolidationThreshold;
+    emit consolidationThresholdChanged(consolidationThreshold);
+}
+
+bool VotingSystem::tracingEnabled() const {
+    return Tracer::isEnabled();
+}
+
+void VotingSystem::setTracingEnabled(bool tracingEnabled) {
+    if (Tracer::isEnabled() == tracingEnabled)
+        return;
+
+    Tracer::setEnabled(tracingEnabled);
+    emit tracingEnabledChanged(tracingEnabled);
+}
+
 void VotingSystem::setCurrentAccount(data::Account* currentAccount) {
     Q_D(VotingSystem);
 
@@ -436,13 +727,16 @@ void VotingSystem::disconnected()
 {
     Q_D(VotingSystem);
 
-    d->backend = nullptr;
-    d->backend = nullptr;
+    // Keep the backend wrapper: it parks replayable requests until the connection manager brings the backend back.
+    // Requests which aren't safe to replay, such as purchases, fail when the client is destroyed.
+    if (d->backend)
+        d->backend->setDisconnected();
     d->client = nullptr;
     d->socketWrapper = nullptr;
     d->socket->close();
 
     emit backendConnectedChanged(false);
+    d->scheduleReconnect();
 }
 
 } // namespace swv
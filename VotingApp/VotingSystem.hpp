@@ -21,6 +21,7 @@
 
 #include "DataStructures/Account.hpp"
 #include "wrappers/Coin.hpp"
+#include "wrappers/BinaryId.hpp"
 
 #include "vendor/QQmlObjectListModel.h"
 
@@ -34,6 +35,8 @@ class ChainAdaptorWrapper;
 class BackendWrapper;
 class DecisionWrapper;
 class ContestWrapper;
+class ContestGeneratorWrapper;
+class ContestFeedModel;
 
 class VotingSystemPrivate;
 /**
@@ -68,6 +71,9 @@ class VotingSystem : public QObject
     Q_PROPERTY(bool isAdaptorReady READ adaptorReady NOTIFY adaptorReadyChanged)
     Q_PROPERTY(swv::ChainAdaptorWrapper* adaptor READ adaptor CONSTANT)
     Q_PROPERTY(swv::BackendWrapper* backend READ backend NOTIFY backendConnectedChanged)
+    Q_PROPERTY(int consolidationThreshold READ consolidationThreshold WRITE setConsolidationThreshold
+               NOTIFY consolidationThresholdChanged)
+    Q_PROPERTY(bool tracingEnabled READ tracingEnabled WRITE setTracingEnabled NOTIFY tracingEnabledChanged)
     QML_SORTABLE_OBJMODEL_PROPERTY(CoinWrapper, coins)
     QML_OBJMODEL_PROPERTY(swv::data::Account, myAccounts)
 
@@ -86,6 +92,8 @@ public:
     BackendWrapper* backend();
 
     swv::data::Account* currentAccount() const;
+    int consolidationThreshold() const;
+    bool tracingEnabled() const;
 
     /**
      * @brief Connect to the backend at the specified network endpoint
@@ -95,6 +103,10 @@ public:
      *
      * The VotingSystem does not retain ownership of the returned promise; it is the caller's responsibility to delete
      * it. The returned promise does not resolve to any value; it has the semantics of a void promise.
+     *
+     * If the connection is later lost, the VotingSystem reconnects to the same endpoint automatically, with jittered
+     * exponential backoff, and re-bootstraps the backend. The backend property retains its identity across the
+     * reconnection; isBackendConnected reflects whether the connection is currently up.
      */
     Q_INVOKABLE Promise* connectToBackend(QString hostname, quint16 port);
 
@@ -105,15 +117,86 @@ public:
      * This method will publish the currentDecision on the specified contest to the chain for the current user. If the
      * decision cannot be cast, an error is emitted.
      *
+     * The decision is published on every balance the current account holds in the contest's coin, all at once. As each
+     * publication completes, decisionCastProgress is emitted. Casts on several contests may be in flight together.
+     *
      * See also @ref cancelCurrentDecision
      */
     Q_INVOKABLE Promise* castCurrentDecision(swv::ContestWrapper* contest);
 
+    /**
+     * @brief Check whether the current account's balances should be consolidated before voting on a contest
+     * @param contest The contest which is about to be voted on
+     * @return A promise which resolves to whether consolidation is recommended, and the number of balances the
+     * current account holds in the contest's coin
+     *
+     * Casting a decision publishes it once per balance, so once an account holds consolidationThreshold or more
+     * balances in the coin, it is cheaper to consolidate them with @ref consolidateBalances before casting.
+     */
+    Q_INVOKABLE Promise* checkConsolidation(swv::ContestWrapper* contest);
+    /**
+     * @brief Merge the current account's balances in a contest's coin into one balance
+     * @param contest The contest whose coin's balances should be merged
+     * @return A promise which resolves when the balances have been merged
+     *
+     * Decisions already cast in the coin are carried over to the merged balance.
+     */
+    Q_INVOKABLE Promise* consolidateBalances(swv::ContestWrapper* contest);
+
     Q_INVOKABLE swv::CoinWrapper* getCoin(quint64 id);
     Q_INVOKABLE swv::CoinWrapper* getCoin(QString name);
 
     Q_INVOKABLE swv::data::Account* getAccount(QString name);
 
+    /**
+     * @brief Fetch the voting volume history of a coin
+     * @param coinId ID of the coin to fetch history for
+     * @param hours Number of hours of history to fetch
+     * @return A promise which resolves when the coin's volumeHistory has been updated, or null if the backend is not
+     * connected
+     *
+     * Volume history is not fetched with the coin list; call this when a coin's history is actually displayed.
+     * Concurrent requests for the same coin's history are not repeated.
+     */
+    Q_INVOKABLE Promise* loadVolumeHistory(quint64 coinId, int hours = 24 * 7);
+
+    /**
+     * @brief Create a list model of the contests produced by a generator
+     * @param generator The generator to page through, such as one from backend.getFeedGenerator(). The model takes
+     * ownership of it.
+     * @return A model suitable for a contest list view, or null if the chain adaptor is not ready. The caller takes
+     * ownership of the model.
+     *
+     * Errors encountered by the model are reported through lastError.
+     */
+    Q_INVOKABLE swv::ContestFeedModel* createContestFeed(swv::ContestGeneratorWrapper* generator);
+
+    /**
+     * @brief Write the trace spans recorded so far to a file, for viewing in chrome://tracing or ui.perfetto.dev
+     * @param path Path of the file to write
+     * @return A promise which resolves when the file has been written
+     *
+     * The spans recorded by the backend are fetched and merged with this process's own, so a request can be followed
+     * from the UI to the server and back. If the backend's spans cannot be fetched, only this process's are written.
+     * Spans are only recorded while tracingEnabled is set (or the SWV_TRACE environment variable was set at startup).
+     */
+    Q_INVOKABLE Promise* exportTrace(QString path);
+    /**
+     * @brief Get the memory used by this process's capnp messages
+     * @return A list of arenas, each a map as described by Stats.ArenaStats. See backend.getMemoryStats() for the
+     * backend's.
+     *
+     * This walks every tracked message, so it is too slow to call on every frame.
+     */
+    Q_INVOKABLE QVariantList memoryStats() const;
+    /**
+     * @brief Get the timing of this process's event loop and the sizes of its task sets
+     * @return A map of "loops" and "taskSets", as described by Stats. See backend.getLoopStats() for the backend's.
+     *
+     * Alerts are logged whenever a loop's turns or lag, or a task set's size, exceed their thresholds.
+     */
+    Q_INVOKABLE QVariantMap loopStats() const;
+
 signals:
     void error(QString message);
     void isReadyChanged();
@@ -121,6 +204,10 @@ signals:
     void backendConnectedChanged(bool backendConnected);
     void adaptorReadyChanged(bool adaptorReady);
     void currentAccountChanged(swv::data::Account* currentAccount);
+    void consolidationThresholdChanged(int consolidationThreshold);
+    void tracingEnabledChanged(bool tracingEnabled);
+    /// Emitted as a cast decision is published on each of the current account's balances
+    void decisionCastProgress(swv::BinaryId contestId, int published, int total);
 
 public slots:
     void configureChainAdaptor(bool useTestingBackend = false);
@@ -135,6 +222,8 @@ public slots:
     void cancelCurrentDecision(swv::ContestWrapper* contest);
 
     void setCurrentAccount(swv::data::Account* currentAccount);
+    void setConsolidationThreshold(int consolidationThreshold);
+    void setTracingEnabled(bool tracingEnabled);
 
 protected slots:
     void setLastError(QString message);
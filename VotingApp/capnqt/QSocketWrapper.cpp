@@ -25,10 +25,26 @@
 
 #include <kj/debug.h>
 
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// Smallest ring allocated; comfortably holds the frame headers and small messages which make up most RPC traffic
+const size_t MINIMUM_READ_BUFFER_CAPACITY = 4096;
+}
+
 QSocketWrapper::QSocketWrapper(QAbstractSocket& stream, QObject* parent)
-    : QObject(parent), stream(stream)
+    : QObject(parent), stream(stream), connectionSpan(swv::Tracer::begin("QSocketWrapper::connection"))
 {
-    QObject::connect(&stream, &QAbstractSocket::disconnected, [this]{eof = true;});
+    QObject::connect(&stream, &QAbstractSocket::readyRead, this, &QSocketWrapper::pumpReads);
+    QObject::connect(&stream, &QAbstractSocket::bytesWritten, this, &QSocketWrapper::drainWrites);
+    QObject::connect(&stream, &QAbstractSocket::disconnected, this, [this]{
+        eof = true;
+        // Pending reads may now be satisfiable by truncation, or must be broken
+        pumpReads();
+        rejectPendingWrites(KJ_EXCEPTION(DISCONNECTED, "Socket was disconnected before write completed."));
+        connectionSpan.end();
+    });
 }
 
 QSocketWrapper::~QSocketWrapper() noexcept {
@@ -40,20 +56,39 @@ QSocketWrapper::~QSocketWrapper() noexcept {
             readContext.fulfiller->reject(KJ_EXCEPTION(DISCONNECTED, "Socket was disconnected before read completed."));
         pendingReads.pop();
     }
+    rejectPendingWrites(KJ_EXCEPTION(DISCONNECTED, "Socket was disconnected before write completed."));
 
     if (stream.state() != QAbstractSocket::UnconnectedState && stream.state() != QAbstractSocket::ClosingState)
         stream.close();
 }
 
 kj::Promise<void> QSocketWrapper::write(const void* buffer, size_t size) {
-    stream.write(static_cast<const char*>(buffer), static_cast<qint64>(size));
-    return kj::READY_NOW;
+    kj::ArrayPtr<const kj::byte> piece(static_cast<const kj::byte*>(buffer), size);
+    return write(kj::arrayPtr(&piece, 1));
 }
 
 kj::Promise<void> QSocketWrapper::write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte> > pieces) {
-    for (const kj::ArrayPtr<const kj::byte> piece : pieces)
-        stream.write(reinterpret_cast<const char*>(piece.begin()), static_cast<qint64>(piece.size()));
-    return kj::READY_NOW;
+    auto span = swv::Tracer::begin("QSocketWrapper::write", connectionSpan);
+    if (atEof())
+        return KJ_EXCEPTION(DISCONNECTED, "Cannot write to a disconnected socket.");
+
+    // QAbstractSocket copies the bytes into its own write buffer, so each piece (capnp's segment table, then the
+    // segments) is handed over directly; gathering them first would only add a copy. The buffers are free for reuse
+    // as soon as this returns.
+    for (const kj::ArrayPtr<const kj::byte> piece : pieces) {
+        auto size = static_cast<qint64>(piece.size());
+        if (stream.write(reinterpret_cast<const char*>(piece.begin()), size) != size)
+            return KJ_EXCEPTION(DISCONNECTED, "Write to socket failed.", stream.errorString().toStdString());
+    }
+
+    if (stream.bytesToWrite() <= writeHighWaterMark && pendingWrites.empty())
+        return kj::READY_NOW;
+
+    // The socket is behind. Hold the writer off until bytesWritten tells us it has caught up.
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    pendingWrites.push(kj::mv(paf.fulfiller));
+    // The span covers the wait for the socket to drain, which is the time the network costs the writer
+    return paf.promise.attach(kj::mv(span));
 }
 
 kj::Promise<size_t> QSocketWrapper::read(void* buffer, size_t minBytes, size_t maxBytes) {
@@ -73,72 +108,70 @@ bool QSocketWrapper::atEof() {
 }
 
 kj::Promise<size_t> QSocketWrapper::readImpl(void* buffer, size_t minBytes, size_t maxBytes, bool truncateForEof) {
-    // Three possibilities here:
-    // - maxBytes are available now, so we return all of them immediately.
-    // - Less than maxBytes are available now, but more than minBytes, so we return all of them immediately.
-    // - Less than minBytes are available, so we construct a promise and wait for more data
-
-    // In the first two cases, we can read immediately, so attemptRead will succeed.
-    auto bytesRead = attemptRead(buffer, minBytes, maxBytes, truncateForEof);
-    if (bytesRead) {
-        return bytesRead;
+    ReadContext context(minBytes, maxBytes, buffer, nullptr, truncateForEof);
+
+    if (!pendingReads.empty()) {
+        // Earlier reads get the bytes first; this one waits its turn in the pump.
+        auto paf = kj::newPromiseAndFulfiller<size_t>();
+        context.fulfiller = kj::mv(paf.fulfiller);
+        pendingReads.push(kj::mv(context));
+        return kj::mv(paf.promise);
     }
+
+    // Three possibilities here:
+    // - At least minBytes are buffered or on the socket now, so we return up to maxBytes of them immediately.
+    // - Less than minBytes are available, but the stream is at EOF, so we truncate or break the read.
+    // - Less than minBytes are available, so we queue a context for the pump and wait for more data.
+    fillReadRequest(context);
+    if (context.bytesRead >= minBytes)
+        return context.bytesRead;
+
     // No point in making a promise if we already know we'll have to break it.
     if (atEof()) {
-        KJ_LOG(ERROR, "Failed read request", buffer, minBytes, stream.bytesAvailable());
+        if (truncateForEof)
+            return context.bytesRead;
+        KJ_LOG(ERROR, "Failed read request", buffer, minBytes, context.bytesRead);
         return KJ_EXCEPTION(DISCONNECTED, "Stream disconnected with less than minBytes readable.",
-                            minBytes, stream.bytesAvailable());
+                            minBytes, context.bytesRead);
     }
 
-    // Third option: make a promise
+    // Third option: make a promise. The bytes copied so far stay in the context's buffer.
     auto paf = kj::newPromiseAndFulfiller<size_t>();
-    pendingReads.emplace(0, minBytes, maxBytes, buffer, kj::mv(paf.fulfiller), truncateForEof);
-    QObject::connect(&stream, &QAbstractSocket::readyRead, this, [this] {
-        while (!pendingReads.empty() && stream.bytesAvailable()) {
-            if (fulfillReadRequest(pendingReads.front()))
-                // The current read context was satisfied.
-                pendingReads.pop();
-            else
-                // Not enough bytes to satisfy the next context are available. Wait for more bytes before continuing.
-                break;
-        }
-    });
-
+    context.fulfiller = kj::mv(paf.fulfiller);
+    pendingReads.push(kj::mv(context));
     return kj::mv(paf.promise);
 }
 
-size_t QSocketWrapper::attemptRead(void* buffer, size_t minBytes, size_t maxBytes, bool truncateForEof) {
-    size_t availableNow = static_cast<size_t>(stream.bytesAvailable());
-    if (availableNow >= maxBytes) {
-        // First option: return all maxBytes now
-        stream.read(static_cast<char*>(buffer), static_cast<qint64>(maxBytes));
-        return maxBytes;
-    }
-    if (availableNow >= minBytes || (truncateForEof && atEof())) {
-        // Second option: return what's available now
-        stream.read(static_cast<char*>(buffer), static_cast<qint64>(availableNow));
-        return availableNow;
+void QSocketWrapper::fillReadRequest(ReadContext& context) {
+    auto room = context.maxBytes - context.bytesRead;
+    context.bytesRead += readBuffer.take(context.buffer + context.bytesRead, room);
+    room = context.maxBytes - context.bytesRead;
+
+    // Only once the ring is empty do we touch the socket, so ordering is preserved. The ring holds at most a small
+    // prefetch, so the bulk of a large segment body is read from the socket straight into the destination.
+    if (room > 0 && stream.bytesAvailable() > 0) {
+        auto bytesRead = stream.read(reinterpret_cast<char*>(context.buffer + context.bytesRead),
+                                     static_cast<qint64>(room));
+        if (bytesRead > 0)
+            context.bytesRead += static_cast<size_t>(bytesRead);
     }
-    return 0;
 }
 
-bool QSocketWrapper::fulfillReadRequest(ReadContext& context) {
-    KJ_REQUIRE(context.maxBytes > 0, "Asked to fill buffer in an empty context. Unable to fulfill request.");
-
-    // If we now have enough bytes, attemptRead succeeds and we're done
-    if (auto bytesRead = attemptRead(context.buffer, context.minBytes, context.maxBytes, context.truncateForEof)) {
-        context.fulfiller->fulfill(kj::mv(bytesRead));
-        context.bytesRead += bytesRead;
-        context.maxBytes -= bytesRead;
-        context.minBytes = 0;
+bool QSocketWrapper::completeReadRequest(ReadContext& context) {
+    if (context.bytesRead >= context.minBytes) {
+        context.fulfiller->fulfill(kj::mv(context.bytesRead));
         return true;
     }
     if (atEof()) {
+        if (context.truncateForEof) {
+            context.fulfiller->fulfill(kj::mv(context.bytesRead));
+            return true;
+        }
         KJ_LOG(ERROR, "Failed read request", context.buffer, context.minBytes,
-               context.maxBytes, context.truncateForEof, stream.bytesAvailable());
+               context.maxBytes, context.bytesRead);
         context.fulfiller->reject(KJ_EXCEPTION(DISCONNECTED,
                                                "Stream disconnected with less than minBytes readable.",
-                                               stream.bytesAvailable(),
+                                               context.bytesRead,
                                                context.minBytes));
         return true;
     }
@@ -146,12 +179,113 @@ bool QSocketWrapper::fulfillReadRequest(ReadContext& context) {
     return false;
 }
 
-QSocketWrapper::ReadContext::ReadContext(size_t bytesRead, size_t minBytes, size_t maxBytes, void* buffer,
+void QSocketWrapper::pumpReads() {
+    auto span = swv::Tracer::begin("QSocketWrapper::pumpReads", connectionSpan);
+    while (!pendingReads.empty()) {
+        auto& context = pendingReads.front();
+        fillReadRequest(context);
+        if (!completeReadRequest(context))
+            // Not enough bytes to satisfy the next context are available. Wait for more bytes before continuing.
+            break;
+        pendingReads.pop();
+    }
+
+    // A little of what no read has asked for yet is moved into the ring in one bulk read, so the next few small reads
+    // (frame headers, segment tables) are served without going back to the socket. The rest stays in the socket's
+    // buffer, where a large read can take it without an extra copy through the ring.
+    if (readBuffer.size() < MINIMUM_READ_BUFFER_CAPACITY)
+        readBuffer.fill(stream, MINIMUM_READ_BUFFER_CAPACITY - readBuffer.size());
+}
+
+void QSocketWrapper::rejectPendingWrites(kj::Exception&& exception) {
+    while (!pendingWrites.empty()) {
+        pendingWrites.front()->reject(kj::cp(exception));
+        pendingWrites.pop();
+    }
+}
+
+void QSocketWrapper::drainWrites() {
+    if (stream.bytesToWrite() > writeHighWaterMark)
+        return;
+
+    // All pending writes are already in the socket's buffer, so they are all released by the same condition
+    while (!pendingWrites.empty()) {
+        pendingWrites.front()->fulfill();
+        pendingWrites.pop();
+    }
+}
+
+QSocketWrapper::ReadContext::ReadContext(size_t minBytes, size_t maxBytes, void* buffer,
                                          kj::Own<kj::PromiseFulfiller<size_t> > fulfiller, bool truncateForEof)
-    : bytesRead(bytesRead),
-      minBytes(minBytes),
+    : minBytes(minBytes),
       maxBytes(maxBytes),
-      buffer(buffer),
+      buffer(static_cast<kj::byte*>(buffer)),
       fulfiller(kj::mv(fulfiller)),
       truncateForEof(truncateForEof)
 {}
+
+size_t QSocketWrapper::ReadBuffer::fill(QIODevice& device, size_t limit) {
+    auto available = std::min(device.bytesAvailable(), static_cast<qint64>(limit));
+    if (available <= 0)
+        return 0;
+
+    reserve(used + static_cast<size_t>(available));
+    auto mask = storage.size() - 1;
+    size_t total = 0;
+
+    // The free space may wrap around the end of storage, so it is filled in at most two contiguous pieces
+    while (total < static_cast<size_t>(available)) {
+        auto tail = (head + used) & mask;
+        auto contiguous = std::min(storage.size() - tail, storage.size() - used);
+        contiguous = std::min(contiguous, static_cast<size_t>(available) - total);
+        auto bytesRead = device.read(reinterpret_cast<char*>(storage.begin() + tail),
+                                     static_cast<qint64>(contiguous));
+        if (bytesRead <= 0)
+            break;
+        used += static_cast<size_t>(bytesRead);
+        total += static_cast<size_t>(bytesRead);
+    }
+
+    return total;
+}
+
+size_t QSocketWrapper::ReadBuffer::take(kj::byte* destination, size_t count) {
+    count = std::min(count, used);
+
+    size_t copied = 0;
+    while (copied < count) {
+        auto contiguous = std::min(count - copied, storage.size() - head);
+        std::memcpy(destination + copied, storage.begin() + head, contiguous);
+        head = (head + contiguous) & (storage.size() - 1);
+        used -= contiguous;
+        copied += contiguous;
+    }
+    // Rewind when empty so the next fill gets the whole ring as one contiguous piece, and give back any growth
+    if (used == 0) {
+        head = 0;
+        if (storage.size() > MINIMUM_READ_BUFFER_CAPACITY)
+            storage = kj::heapArray<kj::byte>(MINIMUM_READ_BUFFER_CAPACITY);
+    }
+
+    return count;
+}
+
+void QSocketWrapper::ReadBuffer::reserve(size_t minimumCapacity) {
+    if (storage.size() >= minimumCapacity)
+        return;
+
+    auto capacity = std::max(storage.size(), MINIMUM_READ_BUFFER_CAPACITY);
+    while (capacity < minimumCapacity)
+        capacity *= 2;
+
+    // Linearize the existing contents at the front of the new storage. This copies directly rather than through take,
+    // which would release the old storage as soon as it emptied.
+    auto newStorage = kj::heapArray<kj::byte>(capacity);
+    if (used > 0) {
+        auto first = std::min(used, storage.size() - head);
+        std::memcpy(newStorage.begin(), storage.begin() + head, first);
+        std::memcpy(newStorage.begin() + first, storage.begin(), used - first);
+    }
+    storage = kj::mv(newStorage);
+    head = 0;
+}
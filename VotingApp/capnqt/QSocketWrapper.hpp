@@ -28,7 +28,10 @@
 
 #include <kj/async-io.h>
 
+#include <Tracer.hpp>
+
 class QAbstractSocket;
+class QIODevice;
 
 /**
  * @brief The QSocketWrapper class implements the kj::AsyncIoStream interface on a QAbstractSocket
@@ -55,31 +58,95 @@ public:
     // AsyncIoStream interface
     virtual void shutdownWrite();
 
+    /**
+     * @brief Set the number of unsent bytes the socket may hold before write promises stop resolving immediately
+     *
+     * QAbstractSocket buffers writes without limit. To keep that buffer bounded on slow links, a write which leaves
+     * more than this many bytes queued on the socket returns a promise which resolves only once the socket has drained
+     * back below the mark. Writers that wait on their promises (as capnp's RPC layer does) therefore slow down to the
+     * speed of the network instead of piling data into memory.
+     */
+    void setWriteHighWaterMark(qint64 bytes) {
+        writeHighWaterMark = bytes;
+    }
+    qint64 getWriteHighWaterMark() const {
+        return writeHighWaterMark;
+    }
+
 private:
+    /**
+     * @brief A growable byte ring which holds data drained from the socket but not yet consumed by a read
+     *
+     * The capacity is always a power of two, so wrapping the indices is a mask rather than a division. The ring only
+     * grows when asked to hold more than its free space, and shrinks back to its minimum capacity once it is emptied.
+     */
+    class ReadBuffer {
+    public:
+        size_t size() const {
+            return used;
+        }
+        bool empty() const {
+            return used == 0;
+        }
+
+        /// @brief Move up to limit of the bytes currently available on device into the ring
+        /// @return The number of bytes moved
+        size_t fill(QIODevice& device, size_t limit);
+        /// @brief Copy up to count bytes out of the ring into destination, consuming them
+        /// @return The number of bytes copied
+        size_t take(kj::byte* destination, size_t count);
+
+    private:
+        void reserve(size_t minimumCapacity);
+
+        kj::Array<kj::byte> storage;
+        size_t head = 0;
+        size_t used = 0;
+    };
+
     QAbstractSocket& stream;
     bool eof = false;
+    // The RPC layer between this and the calls being made doesn't pass their spans down, so reads and writes are traced
+    // as children of the connection instead, as TwoPartyServer traces them on the server
+    swv::Tracer::Span connectionSpan;
+    ReadBuffer readBuffer;
 
     struct ReadContext {
-        ReadContext(size_t bytesRead, size_t minBytes, size_t maxBytes, void* buffer,
+        ReadContext(size_t minBytes, size_t maxBytes, void* buffer,
                     kj::Own<kj::PromiseFulfiller<size_t>> fulfiller, bool truncateForEof);
 
         size_t bytesRead = 0;
         size_t minBytes = 0;
         size_t maxBytes = 0;
-        void* buffer = nullptr;
+        kj::byte* buffer = nullptr;
         kj::Own<kj::PromiseFulfiller<size_t>> fulfiller;
         bool truncateForEof = false;
     };
     std::queue<ReadContext> pendingReads;
 
+    qint64 writeHighWaterMark = 64 * 1024;
+    /// Fulfillers for writes which were accepted while the socket was above the high-water mark
+    std::queue<kj::Own<kj::PromiseFulfiller<void>>> pendingWrites;
+
     bool atEof();
 
     kj::Promise<size_t> readImpl(void* buffer, size_t minBytes, size_t maxBytes, bool truncateForEof);
-    /// @brief Attempt to read at least minBytes and at most maxBytes. Does nothing if at least minBytes are not ready.
-    size_t attemptRead(void* buffer, size_t minBytes, size_t maxBytes, bool truncateForEof);
-    /// @return true if context was satisfied; false otherwise
-    bool fulfillReadRequest(ReadContext& context);
+    /// @brief Copy as many buffered bytes as context can hold into it
+    void fillReadRequest(ReadContext& context);
+    /// @return true if context was satisfied (fulfilled or rejected); false if it must keep waiting
+    bool completeReadRequest(ReadContext& context);
+
+    /// @brief Break all pending write promises with the given exception
+    void rejectPendingWrites(kj::Exception&& exception);
+
+private slots:
+    /// @brief Drain the socket into the read buffer and satisfy as many pending reads as possible, in order
+    ///
+    /// This is the only slot ever connected to readyRead, so the cost of a readyRead does not depend on how many reads
+    /// have been issued over the life of the connection.
+    void pumpReads();
+    /// @brief Resolve pending write promises once the socket's write buffer has drained below the high-water mark
+    void drainWrites();
 };
 
 #endif // QSOCKETWRAPPER
-
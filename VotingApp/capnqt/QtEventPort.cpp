@@ -21,8 +21,17 @@
 
 #include "QtEventPort.hpp"
 
-#include <QGuiApplication>
-#include <QTimer>
+#include <QCoreApplication>
+#include <QEvent>
+
+#include <algorithm>
+
+namespace {
+// Event type used to ask a QtEventPort to run its KJ loop
+const QEvent::Type RunKjLoopEvent = static_cast<QEvent::Type>(QEvent::registerEventType());
+// Number of KJ turns to run between checks of the time slice
+const unsigned TURNS_PER_CHECK = 16;
+}
 
 QtEventPort::~QtEventPort()
 {}
@@ -43,16 +52,46 @@ bool QtEventPort::poll() {
 void QtEventPort::setRunnable(bool runnable) {
     isRunnable = runnable;
 
-    if(runnable)
-        // As per Qt docs, this will schedule run() to be called when all currently pending events have been processed.
-        QTimer::singleShot(0, this, SLOT(run()));
+    if (runnable)
+        scheduleRun();
+}
+
+void QtEventPort::customEvent(QEvent* event) {
+    if (event->type() != RunKjLoopEvent) {
+        QObject::customEvent(event);
+        return;
+    }
+
+    runScheduled = false;
+    run();
+}
+
+void QtEventPort::scheduleRun() {
+    // Coalesce: if a run is already queued, it will pick up whatever became runnable since
+    if (runScheduled)
+        return;
+
+    runScheduled = true;
+    scheduledAt.start();
+    // As per Qt docs, posted events are delivered when control returns to the event loop, after events already queued
+    QCoreApplication::postEvent(this, new QEvent(RunKjLoopEvent));
 }
 
 void QtEventPort::run() {
-    if (kjLoop)
-        kjLoop->run();
+    lastLagNsecs = scheduledAt.nsecsElapsed();
+    maxLagNsecs = std::max(maxLagNsecs, lastLagNsecs);
+    loopMonitor.recordLag(static_cast<quint64>(lastLagNsecs / 1000));
+
+    if (kjLoop) {
+        QElapsedTimer slice;
+        slice.start();
+        do {
+            kjLoop->run(TURNS_PER_CHECK);
+        } while (isRunnable && slice.nsecsElapsed() < timeSliceNsecs);
+        loopMonitor.recordTurn(static_cast<quint64>(slice.nsecsElapsed() / 1000));
+    }
 
     if (isRunnable)
         // Still runnable? OK, but wait your turn
-        QTimer::singleShot(0, this, SLOT(run()));
+        scheduleRun();
 }
@@ -23,14 +23,21 @@
 #define QTEVENTPORT
 
 #include <QObject>
+#include <QElapsedTimer>
 
 #include <kj/async.h>
 
+#include <LoopMonitor.hpp>
+
 class QtEventPort : public QObject, public kj::EventPort
 {
     // Simple EventPort implementation to allow a KJ event loop to run in a thread scheduled by a Qt event loop
     // Make sure to call setLoop with a pointer to the KJ event loop which will be sharing this thread as soon as
     // possible after construction.
+    //
+    // When the KJ loop becomes runnable, a single event is posted to this object; further wakeups are coalesced into
+    // that event until it is delivered. Each delivery runs the KJ loop for at most one time slice, then yields back to
+    // Qt (reposting if KJ still has work) so a large backlog of KJ events cannot starve rendering and input.
     Q_OBJECT
 public:
     virtual ~QtEventPort();
@@ -42,16 +49,48 @@ public:
         this->kjLoop = kjLoop;
     }
 
+    void setTimeSlice(qint64 msecs) {
+        // Set the maximum time, in milliseconds, the KJ loop may run before yielding to the Qt event loop
+        timeSliceNsecs = msecs * 1000000;
+    }
+
+    qint64 lastLag() const {
+        // Time, in microseconds, between the KJ loop last becoming runnable and it actually being run
+        return lastLagNsecs / 1000;
+    }
+    qint64 maxLag() const {
+        // Largest lastLag() observed since the last call to resetMaxLag()
+        return maxLagNsecs / 1000;
+    }
+    void resetMaxLag() {
+        maxLagNsecs = 0;
+    }
+
+    swv::LoopMonitor& monitor() {
+        // Histograms of the time slices run and of the lag before each, with alerts when they grow too long
+        return loopMonitor;
+    }
+
     // EventPort API
     virtual bool wait();
     virtual bool poll();
     virtual void setRunnable(bool runnable);
 
+protected:
+    virtual void customEvent(QEvent* event);
+
 private:
     bool isRunnable = false;
+    bool runScheduled = false;
     kj::EventLoop* kjLoop = nullptr;
 
-private slots:
+    qint64 timeSliceNsecs = 8000000;
+    QElapsedTimer scheduledAt;
+    qint64 lastLagNsecs = 0;
+    qint64 maxLagNsecs = 0;
+    swv::LoopMonitor loopMonitor{"QtEventPort"};
+
+    void scheduleRun();
     void run();
 };
 
@@ -29,6 +29,7 @@
 
 #include <DataStructures/Account.hpp>
 #include "wrappers/Coin.hpp"
+#include "wrappers/BinaryId.hpp"
 #include "wrappers/Balance.hpp"
 #include "wrappers/Contest.hpp"
 #include "wrappers/Decision.hpp"
@@ -39,6 +40,8 @@
 #include "wrappers/BackendWrapper.hpp"
 #include "wrappers/ChainAdaptorWrapper.hpp"
 #include "VotingSystem.hpp"
+#include "ContestFeedModel.hpp"
+#include "ContestResultsModel.hpp"
 #include <Promise.hpp>
 
 #include <capnqt/QtEventPort.hpp>
@@ -96,9 +99,13 @@ int main(int argc, char *argv[])
 #undef REGISTER_ENUM
 
     // Other registrations
+    swv::BinaryId::registerMetaType();
     qmlRegisterType<swv::VotingSystem>("FollowMyVote.StakeWeightedVoting", 1, 0, "VotingSystem");
     qmlRegisterType<Promise>("FollowMyVote.StakeWeightedVoting", 1, 0, "Promise");
     qmlRegisterType<QQmlObjectListModelBase>();
+    qmlRegisterType<swv::TextMapModel>();
+    qmlRegisterType<swv::ContestFeedModel>();
+    qmlRegisterType<swv::ContestResultsModel>();
     qmlRegisterType<QSortFilterProxyModel>();
 
     QQmlApplicationEngine engine;
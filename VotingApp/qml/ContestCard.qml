@@ -23,12 +23,14 @@ import QtGraphicalEffects 1.0
 
 import QtQmlTricks.UiElements 2.0
 
+import VPlayApps 1.0
+
 import FollowMyVote.StakeWeightedVoting 1.0
 
 Rectangle {
     id: card
     x: window.dp(16)
-    height: contestDelegate.y + contestDelegate.height + window.dp(16)
+    height: contestObject? contestLoader.y + contestLoader.height + window.dp(16) : window.dp(160)
 
     property VotingSystem votingsystem
     property int votingStake
@@ -40,15 +42,26 @@ Rectangle {
 
     MouseArea {
         anchors.fill: parent
-        onClicked: card.selected(contestObject)
+        onClicked: if (contestObject) card.selected(contestObject)
         z: -1
     }
-    ContestDelegate {
-        id: contestDelegate
-        displayContest: contestObject
+    // The feed releases the contest objects of rows far from view, and reloads them when they come back, so a card
+    // scrolled back into view may have no contest for a moment. Show a placeholder until it arrives.
+    Loader {
+        id: contestLoader
         ExtraAnchors.topDock: parent
         anchors.margins: window.dp(16)
-        onCastButtonClicked: votingSystem.castCurrentDecision(displayContest)
-        onCancelButtonClicked: votingSystem.cancelCurrentDecision(displayContest)
+        active: !!contestObject
+        sourceComponent: ContestDelegate {
+            displayContest: contestObject
+            onCastButtonClicked: window.castDecision(displayContest)
+            onCancelButtonClicked: votingSystem.cancelCurrentDecision(displayContest)
+        }
+    }
+    AppText {
+        anchors.centerIn: parent
+        visible: !contestObject
+        text: qsTr("Loading...")
+        opacity: .54
     }
 }
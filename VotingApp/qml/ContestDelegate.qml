@@ -73,7 +73,7 @@ Column {
     GridContainer {
         id: contestantGrid
         cols: Math.min(Math.max(1, Math.floor(width / contestantMinimumWidth())),
-                       displayContest.contestants.length)
+                       displayContest.contestants.count)
         width: parent.width
         colSpacing: window.dp(8)
         rowSpacing: colSpacing
@@ -94,8 +94,21 @@ Column {
                 Behavior on color { ColorAnimation { easing.type: Easing.OutQuad } }
                 Behavior on opacity { NumberAnimation { easing.type: Easing.OutQuad } }
 
-                property bool isSelected: !!displayContest.currentDecision &&
-                                          !!displayContest.currentDecision.opinions[index]
+                // Read through opinion() rather than the opinions map, so an edit doesn't rebuild the whole map for
+                // every contestant
+                property bool isSelected: false
+                function refreshSelection() {
+                    isSelected = !!displayContest.currentDecision && displayContest.currentDecision.opinion(index) !== 0
+                }
+                Component.onCompleted: refreshSelection()
+                Connections {
+                    target: displayContest
+                    onCurrentDecisionChanged: contestantButton.refreshSelection()
+                }
+                Connections {
+                    target: displayContest.currentDecision
+                    onOpinionsChanged: contestantButton.refreshSelection()
+                }
 
                 property alias contentHeight: contestantColumn.height
 
@@ -103,9 +116,16 @@ Column {
                     z: 0
                     anchors.fill: parent
                     onClicked: {
-                        var opinions = {}
-                        opinions[index] = !isSelected
-                        displayContest.currentDecision.opinions = opinions
+                        var decision = displayContest.currentDecision
+                        if (isSelected) {
+                            decision.setOpinion(index, 0)
+                            return
+                        }
+                        // Only one contestant may be chosen, so clear whichever was chosen before
+                        for (var i = 0; i < contestantRepeater.count; ++i)
+                            if (i !== index && decision.opinion(i) !== 0)
+                                decision.setOpinion(i, 0)
+                        decision.setOpinion(index, 1)
                     }
                 }
                 ColumnLayout {
@@ -115,7 +135,7 @@ Column {
                     y: window.dp(8)
 
                     AppText {
-                        text: modelData.name
+                        text: model.name
                         Layout.fillWidth: true
                         wrapMode: Text.WrapAtWordBoundaryOrAnywhere
                         color: contestantButton.isSelected? "white" : "black"
@@ -125,7 +145,7 @@ Column {
                         id: contestantDescription
                         maximumHeight: window.dp(80)
                         Layout.fillWidth: true
-                        text: modelData.description
+                        text: model.description
                         textItem.color: contestantButton.isSelected? "white" : "black"
                     }
                     AppButton {
@@ -134,7 +154,7 @@ Column {
                         visible: contestantDescription.truncated
                         Layout.alignment: Qt.AlignHCenter
                         Layout.preferredWidth: minimumWidth
-                        onClicked: NativeDialog.confirm(modelData.name, modelData.description, function(){}, false)
+                        onClicked: NativeDialog.confirm(model.name, model.description, function(){}, false)
                         Layout.preferredHeight: contentHeight
                     }
                 }
@@ -34,13 +34,31 @@ ListPage {
     property var getContestGeneratorFunction
     property VotingSystem votingSystem
 
-    function reloadContests() { contestList.reloadContests() }
+    // Model of the contests; created from getContestGeneratorFunction when the contests are first loaded
+    property var contestFeed: null
+
+    function reloadContests() {
+        var generator = getContestGeneratorFunction()
+        contestFeed = generator ? votingSystem.createContestFeed(generator) : null
+        updateViewport()
+    }
     function loadContests() {
         console.log("Loading contests...")
-        contestList.loadContests()
+        if (!contestFeed)
+            reloadContests()
+        else
+            updateViewport()
+    }
+    // Tell the model what's on screen, so it can prefetch ahead of it and release what's far behind it
+    function updateViewport() {
+        if (!contestFeed)
+            return
+        var x = listView.width / 2
+        contestFeed.setViewport(listView.indexAt(x, listView.contentY),
+                                listView.indexAt(x, listView.contentY + listView.height - 1))
     }
 
-    model: contestList
+    model: contestFeed
     delegate: ContestCard {
         votingsystem: contestListPage.votingSystem
         contestObject: model.contestObject
@@ -55,43 +73,15 @@ ListPage {
     listView.rightMargin: window.dp(16)
     listView.topMargin: window.dp(16)
     listView.spacing: window.dp(16)
+    listView.footer: contestFeed && contestFeed.atEnd ? noMoreContestsComponent : null
     listView.onAtYEndChanged: {
         if(listView.atYEnd && votingSystem.isReady) {
-            contestList.loadContests()
-        }
-    }
-    listView.onCountChanged: if (listView.contentHeight < height && votingSystem.isReady)
-                                 contestList.loadContests()
-
-    ListModel {
-        id: contestList
-
-        property var contestGenerator
-
-        function reloadContests() {
-            contestGenerator = null
-            contestList.clear()
             loadContests()
         }
-        function loadContests() {
-            if (!contestGenerator) {
-                console.log("Setting contest generator")
-                contestGenerator = getContestGeneratorFunction()
-            }
-
-            contestGenerator.getContests(3).then(function (contests) {
-                contests.forEach(function(contest) {
-                    votingSystem.adaptor.getContest(contest.contestId).then(function(contestObject) {
-                        contest.contestObject = contestObject
-                        contestList.append(contest)
-                    }, function(error) {
-                        console.log("Error when loading contest %1:\n%2".arg(contest.contestId).arg(error))
-                    })
-                })
-                if(contests.length < 3) listView.footer = noMoreContestsComponent
-            })
-        }
     }
+    listView.onContentYChanged: updateViewport()
+    listView.onHeightChanged: updateViewport()
+
     Component {
         id: noMoreContestsComponent
         Item {
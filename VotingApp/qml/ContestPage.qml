@@ -29,7 +29,7 @@ Page {
                 id: delegate
 
                 ExtraAnchors.horizontalFill: parent
-                onCastButtonClicked: votingSystem.castCurrentDecision(displayContest)
+                onCastButtonClicked: window.castDecision(displayContest)
                 onCancelButtonClicked: votingSystem.cancelCurrentDecision(displayContest)
             }
         }
@@ -40,6 +40,28 @@ App {
     function showError(errorMessage) {
         NativeDialog.confirm(qsTr("Error"), qsTr("An error has occurred:\n%1").arg(errorMessage), function(){}, false)
     }
+    function castDecision(contest) {
+        // A decision is published once per balance, so offer to combine balances first if there are many of them
+        var check = _votingSystem.checkConsolidation(contest)
+        if (!check)
+            return _votingSystem.castCurrentDecision(contest)
+
+        check.then(function(recommended, balanceCount) {
+            if (!recommended)
+                return _votingSystem.castCurrentDecision(contest)
+
+            NativeDialog.confirm(qsTr("Combine balances?"),
+                                 qsTr("Your vote will be published separately on each of your %1 balances in this " +
+                                      "coin. Combine them into one balance before voting?").arg(balanceCount),
+                                 function(accepted) {
+                                     var merge = accepted? _votingSystem.consolidateBalances(contest) : null
+                                     if (merge)
+                                         merge.then(function() { _votingSystem.castCurrentDecision(contest) })
+                                     else
+                                         _votingSystem.castCurrentDecision(contest)
+                                 }, true)
+        })
+    }
 
     Action {
         shortcut: "Ctrl+Q"
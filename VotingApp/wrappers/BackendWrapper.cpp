@@ -21,8 +21,11 @@
 #include "wrappers/ContestGeneratorWrapper.hpp"
 #include "wrappers/PurchaseContestRequest.hpp"
 #include "wrappers/ContestCreator.hpp"
+#include "wrappers/Converters.hpp"
+#include "ContestResultsModel.hpp"
 
 #include <Promise.hpp>
+#include <Tracer.hpp>
 
 #include <kj/debug.h>
 
@@ -43,38 +46,49 @@ BackendWrapper::~BackendWrapper() noexcept
 
 ContestGeneratorWrapper* BackendWrapper::getFeedGenerator()
 {
-    return new ContestGeneratorWrapper(m_backend.getContestFeedRequest().send().getGenerator(), promiseConverter);
+    return wrapGenerator([](Backend::Client backend) {
+        auto span = Tracer::begin("BackendWrapper::getFeedGenerator");
+        auto request = backend.getContestFeedRequest();
+        span.propagate(request.initTrace());
+        return request.send().getGenerator();
+    });
 }
 
 ContestGeneratorWrapper* BackendWrapper::getContestsByCreator(QString creator)
 {
-    auto request = m_backend.searchContestsRequest();
-    auto filters = request.initFilters(1);
-    filters[0].setType(Backend::Filter::Type::CONTEST_CREATOR);
-    auto arguments = filters[0].initArguments(1);
-    arguments.set(0, creator.toStdString());
-
-    return new ContestGeneratorWrapper(request.send().getGenerator(), promiseConverter);
+    return wrapGenerator([creator](Backend::Client backend) {
+        auto request = backend.searchContestsRequest();
+        auto filters = request.initFilters(1);
+        filters[0].setType(Backend::Filter::Type::CONTEST_CREATOR);
+        auto arguments = filters[0].initArguments(1);
+        arguments.set(0, creator.toStdString());
+
+        return request.send().getGenerator();
+    });
 }
 
 ContestGeneratorWrapper* BackendWrapper::getContestsByCoin(quint64 coinId)
 {
-    auto request = m_backend.searchContestsRequest();
-    auto filters = request.initFilters(1);
-    filters[0].setType(Backend::Filter::Type::CONTEST_COIN);
-    auto arguments = filters[0].initArguments(1);
-    arguments.set(0, std::to_string(coinId));
-
-    return new ContestGeneratorWrapper(request.send().getGenerator(), promiseConverter);
+    return wrapGenerator([coinId](Backend::Client backend) {
+        auto request = backend.searchContestsRequest();
+        auto filters = request.initFilters(1);
+        filters[0].setType(Backend::Filter::Type::CONTEST_COIN);
+        auto arguments = filters[0].initArguments(1);
+        arguments.set(0, std::to_string(coinId));
+
+        return request.send().getGenerator();
+    });
 }
 
 ContestGeneratorWrapper*BackendWrapper::getVotedContests()
 {
-    auto request = m_backend.searchContestsRequest();
-    auto filters = request.initFilters(1);
-    filters[0].setType(Backend::Filter::Type::CONTEST_VOTER);
+    return wrapGenerator([](Backend::Client backend) {
+        auto request = backend.searchContestsRequest();
+        auto filters = request.initFilters(1);
+        filters[0].setType(Backend::Filter::Type::CONTEST_VOTER);
 
-    return new ContestGeneratorWrapper(request.send().getGenerator(), promiseConverter);
+        return request.send().getGenerator();
+    });
 }
 
 ContestCreatorWrapper*BackendWrapper::contestCreator()
@@ -85,4 +99,69 @@ ContestCreatorWrapper*BackendWrapper::contestCreator()
     return creator.get();
 }
 
+kj::Promise<Backend::Client> BackendWrapper::whenConnected()
+{
+    if (connected)
+        return m_backend;
+
+    auto paf = kj::newPromiseAndFulfiller<Backend::Client>();
+    connectionWaiters.emplace_back(kj::mv(paf.fulfiller));
+    return kj::mv(paf.promise);
+}
+
+void BackendWrapper::setDisconnected()
+{
+    connected = false;
+    m_backend = Backend::Client(capnp::newBrokenCap(KJ_EXCEPTION(DISCONNECTED, "Connection to backend was lost")));
+}
+
+void BackendWrapper::setBackend(Backend::Client backend)
+{
+    m_backend = kj::mv(backend);
+    connected = true;
+    ++epoch;
+
+    // Waiters may call whenConnected() again while being resolved; swap the list out first
+    auto waiters = kj::mv(connectionWaiters);
+    connectionWaiters.clear();
+    for (auto& waiter : waiters)
+        waiter->fulfill(Backend::Client(m_backend));
+}
+
+ContestResultsModel* BackendWrapper::getContestResults(BinaryId contestId)
+{
+    auto span = Tracer::begin("BackendWrapper::getContestResults");
+    auto request = m_backend.getContestResultsRequest();
+    request.setContestId(contestId.data());
+    span.propagate(request.initTrace());
+    return new ContestResultsModel(request.send().getResults(), promiseConverter);
+}
+
+Promise* BackendWrapper::getMemoryStats()
+{
+    using Results = Backend::GetStatsResults;
+    kj::Promise<capnp::Response<Results>> promise = m_backend.getStatsRequest().send();
+    return promiseConverter.convert(kj::mv(promise), [](capnp::Response<Results> r) {
+        QVariantList arenas;
+        for (auto arena : r.getStats().getArenas())
+            arenas.append(convertArenaStats(arena));
+        return QVariantList{QVariant(arenas)};
+    });
+}
+
+Promise* BackendWrapper::getLoopStats()
+{
+    using Results = Backend::GetStatsResults;
+    kj::Promise<capnp::Response<Results>> promise = m_backend.getStatsRequest().send();
+    return promiseConverter.convert(kj::mv(promise), [](capnp::Response<Results> r) {
+        return QVariantList{convertLoopStats(r.getStats())};
+    });
+}
+
+ContestGeneratorWrapper* BackendWrapper::wrapGenerator(std::function<ContestGenerator::Client(Backend::Client)> factory)
+{
+    // The generator keeps the factory so it can re-create itself from the same query after a reconnection
+    return new ContestGeneratorWrapper(kj::mv(factory), *this, promiseConverter);
+}
+
 } // namespace swv
@@ -19,15 +19,21 @@
 #ifndef BACKENDWRAPPER_HPP
 #define BACKENDWRAPPER_HPP
 
+#include "BinaryId.hpp"
+
 #include <QObject>
 
 #include <backend.capnp.h>
 
+#include <functional>
+#include <vector>
+
 class Promise;
 class PromiseConverter;
 namespace swv {
 class ContestGeneratorWrapper;
 class ContestCreatorWrapper;
+class ContestResultsModel;
 
 /**
  * @brief The BackendWrapper class provides a QML-friendly wrapper for the backend API
@@ -37,10 +43,11 @@ class ContestCreatorWrapper;
  * the backend returns with other QML-friendly wrappers.
  *
  * All remote calls return a Promise for the result. If the server returns an error on some call, the result promise
- * will be broken, and supplied with the error. This class takes a connected backend client to begin with, and assumes
- * that this client will always be valid. It is the responsibility of the owner of this BackendWrapper to handle
- * disconnections or other failure conditions of the client. The PromiseWrapper passed to this class's constructor will
- * receive any errors from the backend.
+ * will be broken, and supplied with the error. This class takes a connected backend client to begin with. It is the
+ * responsibility of the owner of this BackendWrapper to notice disconnections, call setDisconnected(), and supply a new
+ * client via setBackend() once it has reconnected. The wrapper itself survives reconnections, so QML bindings to it and
+ * the generators it created remain valid; generators re-create themselves against the new client and replay their
+ * outstanding requests. The PromiseWrapper passed to this class's constructor will receive any errors from the backend.
  */
 class BackendWrapper : public QObject
 {
@@ -59,15 +66,61 @@ public:
     Q_INVOKABLE swv::ContestGeneratorWrapper* getContestsByCoin(quint64 coinId);
     /// @brief Get the contests the current user has voted on
     Q_INVOKABLE swv::ContestGeneratorWrapper* getVotedContests();
+    /// @brief Get a model of the live results of a contest, which stays up to date until it is destroyed. The results
+    /// are not re-subscribed after a reconnection.
+    Q_INVOKABLE swv::ContestResultsModel* getContestResults(swv::BinaryId contestId);
+    /// @brief Get the memory used by the backend's messages
+    /// @return A promise which resolves to a list of arenas, each a map as described by Stats.ArenaStats
+    Q_INVOKABLE Promise* getMemoryStats();
+    /// @brief Get the timing of the backend's event loop and the sizes of its task sets
+    /// @return A promise which resolves to a map of "loops" and "taskSets", as described by Stats
+    Q_INVOKABLE Promise* getLoopStats();
 
     swv::ContestCreatorWrapper* contestCreator();
 
     Backend::Client backend() { return m_backend; }
 
+    /// @brief Whether the current backend client is believed to be connected
+    bool isConnected() const { return connected; }
+    /**
+     * @brief Get a counter which is incremented each time a new backend client is set
+     *
+     * Holders of capabilities obtained from the backend can compare this against the value they saw when obtaining
+     * them to determine whether their capabilities belong to a dead connection and must be re-created.
+     */
+    quint64 connectionEpoch() const { return epoch; }
+    /**
+     * @brief Get a promise for the backend client, which resolves once the backend is connected
+     *
+     * If the backend is connected, the promise is already resolved. Otherwise, it resolves when setBackend() is next
+     * called.
+     */
+    kj::Promise<Backend::Client> whenConnected();
+
+    /**
+     * @brief Mark the backend as lost
+     *
+     * The current client is replaced with one which fails all calls with a DISCONNECTED exception, so that callers
+     * which know how to replay their requests will wait for the reconnection.
+     */
+    void setDisconnected();
+    /**
+     * @brief Replace the backend client with a newly connected one
+     * @param backend The new backend client
+     *
+     * Resolves all promises returned by whenConnected() since the backend was lost.
+     */
+    void setBackend(Backend::Client backend);
+
 private:
     PromiseConverter& promiseConverter;
     Backend::Client m_backend;
     kj::Own<ContestCreatorWrapper> creator;
+    bool connected = true;
+    quint64 epoch = 0;
+    std::vector<kj::Own<kj::PromiseFulfiller<Backend::Client>>> connectionWaiters;
+
+    ContestGeneratorWrapper* wrapGenerator(std::function<ContestGenerator::Client(Backend::Client)> factory);
 };
 
 } // namespace swv
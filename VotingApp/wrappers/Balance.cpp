@@ -25,10 +25,9 @@ BalanceWrapper::BalanceWrapper(BalanceWrapper::Reader r, QObject* parent)
       ::Balance::Reader(r)
 {}
 
-QString BalanceWrapper::id() const
+BinaryId BalanceWrapper::id() const
 {
-    auto reader = getId();
-    return QByteArray::fromRawData((char*)reader.begin(), reader.size()).toHex();
+    return BinaryId(getId());
 }
 
 } // namespace swv
@@ -19,6 +19,8 @@
 #ifndef BALANCE_HPP
 #define BALANCE_HPP
 
+#include "BinaryId.hpp"
+
 #include "balance.capnp.h"
 
 #include <QObject>
@@ -31,13 +33,13 @@ namespace swv {
 class BalanceWrapper : public QObject, public ::Balance::Reader
 {
     Q_OBJECT
-    Q_PROPERTY(QString id READ id CONSTANT)
+    Q_PROPERTY(swv::BinaryId id READ id CONSTANT)
     Q_PROPERTY(qint64 amount READ getAmount CONSTANT)
     Q_PROPERTY(quint64 type READ getType CONSTANT)
 public:
     BalanceWrapper(::Balance::Reader r, QObject* parent = nullptr);
 
-    QString id() const;
+    BinaryId id() const;
 };
 
 } // namespace swv
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BINARYID_HPP
+#define BINARYID_HPP
+
+#include <capnp/blob.h>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMetaType>
+#include <QString>
+
+namespace swv {
+
+/**
+ * @brief The BinaryId class is a compact value type for the binary IDs of chain objects (contests, decisions, balances)
+ *
+ * The ID is held as raw bytes in an implicitly shared QByteArray, so copying it is cheap and comparing or hashing it
+ * touches only the bytes themselves. It can be used directly as a QHash or std::map key, and passed to and from QML,
+ * where it is opaque except for its hex property; the hex form is only ever computed for display.
+ *
+ * For compatibility with callers that still hold hex strings, a converter from QString is registered with the meta
+ * type system by @ref registerMetaType, so a hex string passed where a BinaryId is expected is accepted.
+ */
+class BinaryId
+{
+    Q_GADGET
+    Q_PROPERTY(QString hex READ toString)
+    Q_PROPERTY(bool isEmpty READ isEmpty)
+
+    QByteArray m_bytes;
+
+public:
+    BinaryId() = default;
+    explicit BinaryId(QByteArray bytes)
+        : m_bytes(kj::mv(bytes)) {}
+    /// Copies the bytes out of the reader; the ID does not reference the message afterwards
+    explicit BinaryId(capnp::Data::Reader data)
+        : m_bytes(reinterpret_cast<const char*>(data.begin()), static_cast<int>(data.size())) {}
+
+    static BinaryId fromHex(QString hex) {
+        return BinaryId(QByteArray::fromHex(hex.toLatin1()));
+    }
+    /// Register the meta type and its conversions to and from QString. Call once, before QML is loaded.
+    static void registerMetaType();
+
+    const QByteArray& bytes() const {
+        return m_bytes;
+    }
+    bool isEmpty() const {
+        return m_bytes.isEmpty();
+    }
+    /// View the ID as a capnp::Data::Reader, valid as long as this BinaryId is
+    capnp::Data::Reader data() const {
+        return capnp::Data::Reader(reinterpret_cast<const kj::byte*>(m_bytes.constData()),
+                                   static_cast<size_t>(m_bytes.size()));
+    }
+
+    /// Hexadecimal representation of the ID, for display
+    Q_INVOKABLE QString toString() const {
+        return QString::fromLatin1(m_bytes.toHex());
+    }
+
+    bool operator==(const BinaryId& other) const {
+        return m_bytes == other.m_bytes;
+    }
+    bool operator!=(const BinaryId& other) const {
+        return m_bytes != other.m_bytes;
+    }
+    bool operator<(const BinaryId& other) const {
+        return m_bytes < other.m_bytes;
+    }
+    bool operator==(capnp::Data::Reader other) const {
+        return data() == other;
+    }
+};
+
+inline uint qHash(const BinaryId& id, uint seed = 0) {
+    return qHash(id.bytes(), seed);
+}
+
+} // namespace swv
+
+Q_DECLARE_METATYPE(swv::BinaryId)
+
+#endif // BINARYID_HPP
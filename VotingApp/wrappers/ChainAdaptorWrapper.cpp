@@ -23,19 +23,48 @@
 #include "wrappers/Converters.hpp"
 #include "Promise.hpp"
 #include "PromiseConverter.hpp"
+#include "ResponseCache.hpp"
+#include "DecisionStore.hpp"
 
 #include "BlockchainAdaptorInterface.hpp"
 
 #include <kj/debug.h>
 
+#include <algorithm>
+
 namespace swv {
 
-const static QString PERSISTENT_DECISION_KEY = QStringLiteral("persistedDecisions/%1");
+namespace {
+/// Whether two datagrams have the same content, by hash if the adaptor provided hashes
+bool sameContent(::Datagram::Reader a, ::Datagram::Reader b) {
+    if (a.hasContentHash() && b.hasContentHash())
+        return a.getContentHash() == b.getContentHash();
+    return a.getContent() == b.getContent();
+}
+} // anonymous namespace
+
+// Where older versions persisted decisions; these are migrated into the DecisionStore
+const static QString LEGACY_PERSISTED_DECISIONS = QStringLiteral("persistedDecisions");
 
-ChainAdaptorWrapper::ChainAdaptorWrapper(PromiseConverter& promiseConverter, QObject *parent)
+ChainAdaptorWrapper::ChainAdaptorWrapper(PromiseConverter& promiseConverter, ResponseCache& cache,
+                                         DecisionStore& decisionStore, QObject *parent)
     : QObject(parent),
-      promiseConverter(promiseConverter)
-{}
+      promiseConverter(promiseConverter),
+      cache(cache),
+      decisionStore(decisionStore)
+{
+    QSettings settings;
+    settings.beginGroup(LEGACY_PERSISTED_DECISIONS);
+    auto contestIds = settings.childKeys();
+    for (const auto& contestId : contestIds)
+        decisionStore.put(QByteArray::fromHex(contestId.toLatin1()), settings.value(contestId).toByteArray());
+    settings.endGroup();
+    if (!contestIds.isEmpty()) {
+        KJ_LOG(INFO, "Migrated persisted decisions out of settings", contestIds.size());
+        decisionStore.flush();
+        settings.remove(LEGACY_PERSISTED_DECISIONS);
+    }
+}
 
 ChainAdaptorWrapper::~ChainAdaptorWrapper() noexcept
 {}
@@ -52,7 +81,7 @@ kj::Own<BlockchainAdaptorInterface> ChainAdaptorWrapper::takeAdaptor() {
     return tmp;
 }
 
-Promise* ChainAdaptorWrapper::getDecision(QString owner, QString contestId)
+Promise* ChainAdaptorWrapper::getDecision(QString owner, BinaryId contestId)
 {
     auto promise = _getDecision(kj::mv(owner), kj::mv(contestId));
     return promiseConverter.convert(kj::mv(promise), [](OwningWrapper<swv::DecisionWrapper>* d) -> QVariantList {
@@ -60,12 +89,13 @@ Promise* ChainAdaptorWrapper::getDecision(QString owner, QString contestId)
     });
 }
 
-kj::Promise<OwningWrapper<DecisionWrapper>*> ChainAdaptorWrapper::_getDecision(QString owner, QString contestId)
+kj::Promise<OwningWrapper<DecisionWrapper>*> ChainAdaptorWrapper::_getDecision(QString owner, BinaryId contestId)
 {
     if (!hasAdaptor()) return KJ_EXCEPTION(FAILED, "No blockchain adaptor is set.");
 
     using Reader = ::Balance::Reader;
-    auto promise = m_adaptor->getContest(QByteArray::fromHex(contestId.toLocal8Bit())).then([=](::Contest::Reader c) {
+    using MaybeDatagram = kj::Maybe<::Datagram::Reader>;
+    auto promise = m_adaptor->getContest(contestId.bytes()).then([=](::Contest::Reader c) {
         return m_adaptor->getBalancesForOwner(owner).then([c](kj::Array<Reader> balances) {
             return std::make_tuple(c, kj::mv(balances));
         });
@@ -79,69 +109,33 @@ kj::Promise<OwningWrapper<DecisionWrapper>*> ChainAdaptorWrapper::_getDecision(Q
         });
         KJ_REQUIRE(newEnd - balances.begin() > 0, "No balances found in the contest's coin, so no decision exists.");
 
-        // This struct is basically a lambda on steroids. I'm using it to transform the array of balances into an array
-        // of datagrams containing the decision I want on each of those balances. Also, make sure the newest balance's
-        // decision is in the front (I don't care about preserving order) so that the newest decision will be returned.
-        struct {
-            // Capture this
-            ChainAdaptorWrapper* wrapper;
-            // Capture contestId
-            QString contestId;
-            // For each balance, look up the datagram containing the relevant decision. Store the promises in this array
-            kj::ArrayBuilder<kj::Promise<kj::Maybe<::Datagram::Reader>>> datagramPromises;
-
-            Reader newestBalance;
-            void operator() (Reader balance) {
-                if (datagramPromises.size() == 0) {
-                    // First balance. Nothing to compare.
-                    newestBalance = balance;
-                }
-
-                // Start a lookup for the datagram and store the promise.
-                auto promise = wrapper->m_adaptor->getDatagram(convertBlob(balance.getId()),
-                                                               Datagram::DatagramType::DECISION,
-                                                               contestId);
-                datagramPromises.add(promise.then([](::Datagram::Reader r) -> kj::Maybe<::Datagram::Reader> {
-                        return r;
-                    }, [](kj::Exception e) -> kj::Maybe<::Datagram::Reader> {
-                        qInfo() << "Got exception when fetching datagram on balance:" << e.getDescription().cStr();
-                        return {};
-                    })
-                );
-
-                // If this balance is newer than the previous newest, move its promise to the front
-                if (balance.getCreationOrder() > newestBalance.getCreationOrder()) {
-                    newestBalance = balance;
-                    std::swap(datagramPromises.front(), datagramPromises.back());
-                }
-            }
-        } accumulator{this, contestId,
-                    kj::heapArrayBuilder<kj::Promise<kj::Maybe<::Datagram::Reader>>>(newEnd - balances.begin()), {}};
-
-        // Process all of the balances. Fetch the appropriate decision for each.
+        // Fetch the decision on each of the balances at once. Put the newest balance first, so that its decision is
+        // the one returned.
+        auto newest = std::max_element(balances.begin(), newEnd, [](Reader a, Reader b) {
+            return a.getCreationOrder() < b.getCreationOrder();
+        });
+        std::iter_swap(balances.begin(), newest);
         qDebug() << "Looking for decisions on" << newEnd - balances.begin() << "balances.";
-        accumulator = std::for_each(balances.begin(), newEnd, kj::mv(accumulator));
-
-        return kj::joinPromises(accumulator.datagramPromises.finish());
-    }).then([=](kj::Array<kj::Maybe<::Datagram::Reader>> datagrams) {
-        std::unique_ptr<OwningWrapper<swv::DecisionWrapper>> decision;
-        for (auto datagramMaybe : datagrams) {
-            KJ_IF_MAYBE(datagram, datagramMaybe) {
-                decision.reset(OwningWrapper<DecisionWrapper>::deserialize(convertBlob(datagram->getContent())));
-                break;
-            }
-        }
-        KJ_REQUIRE(decision.get() != nullptr,
+        auto balanceIds = kj::heapArrayBuilder<QByteArray>(newEnd - balances.begin());
+        for (auto balance = balances.begin(); balance != newEnd; ++balance)
+            balanceIds.add(convertBlob(balance->getId()));
+
+        return m_adaptor->getDatagrams(balanceIds.finish(), Datagram::DatagramType::DECISION, contestId.bytes());
+    }).then([=](kj::Array<MaybeDatagram> datagrams) {
+        auto found = std::find_if(datagrams.begin(), datagrams.end(), [](const MaybeDatagram& datagram) {
+            return datagram != nullptr;
+        });
+        KJ_REQUIRE(found != datagrams.end(),
                    "No decision found on chain for the requested contest and owner",
-                   contestId.toStdString(),
+                   contestId.toString().toStdString(),
                    owner.toStdString());
+        auto& datagram = KJ_ASSERT_NONNULL(*found);
 
-        // Search for non-matching or missing decisions, which would mean the decision is stale.
-        for (auto maybeReader : datagrams) {
-            KJ_IF_MAYBE(reader, maybeReader) {
-                std::unique_ptr<OwningWrapper<swv::DecisionWrapper>> otherDecision(
-                            OwningWrapper<swv::DecisionWrapper>::deserialize(convertBlob(reader->getContent())));
-                if (*otherDecision != *decision) {
+        // If any balance has a different decision or none at all, the decision is stale. Comparing the content hashes
+        // tells us without deserializing the other decisions.
+        for (auto& maybeOther : datagrams) {
+            KJ_IF_MAYBE(other, maybeOther) {
+                if (!sameContent(*other, datagram)) {
                     emit contestActionRequired(contestId);
                     break;
                 }
@@ -150,7 +144,8 @@ kj::Promise<OwningWrapper<DecisionWrapper>*> ChainAdaptorWrapper::_getDecision(Q
                 break;
             }
         }
-        return decision.release();
+
+        return OwningWrapper<DecisionWrapper>::deserialize(convertBlobView(datagram.getContent()));
     });
 
     return kj::mv(promise);
@@ -193,40 +188,15 @@ Promise* ChainAdaptorWrapper::getBalancesForOwner(QString owner)
     return nullptr;
 }
 
-Promise* ChainAdaptorWrapper::getContest(QString contestId)
+Promise* ChainAdaptorWrapper::getContest(BinaryId contestId)
 {
-    QByteArray realContestId = QByteArray::fromHex(contestId.toLocal8Bit());
     if (hasAdaptor()) {
-        auto promise = m_adaptor->getContest(realContestId).then([this](::Contest::Reader r) {
-            //TODO: Check signature
-            auto contest = new ContestWrapper(r.getContest());
-            QQmlEngine::setObjectOwnership(contest, QQmlEngine::JavaScriptOwnership);
-            auto decision = new OwningWrapper<DecisionWrapper>(contest);
-
-            // Defer persistence concerns until later; the contest doesn't know about the QML engine yet so we can't
-            // manipulate the QJSValue properties
-            QTimer::singleShot(0, [this, contest, decision]() mutable {
-                QSettings settings;
-                auto key = PERSISTENT_DECISION_KEY.arg(contest->id());
-                if (settings.contains(key)) {
-                    try {
-                        auto bytes = settings.value(key, QByteArray()).toByteArray();
-                        decision = OwningWrapper<DecisionWrapper>::deserialize(bytes, contest);
-                        contest->setCurrentDecision(decision);
-                    } catch (kj::Exception e) {
-                        emit error(tr("Error when recovering decision: %1")
-                                   .arg(QString::fromStdString(e.getDescription())));
-                    }
-                }
-                auto persist = [key, decision] {
-                    QSettings settings;
-                    auto bytes = decision->serialize();
-                    settings.setValue(key, bytes);
-                };
-                connect(decision, &OwningWrapper<DecisionWrapper>::opinionsChanged, persist);
-                connect(decision, &OwningWrapper<DecisionWrapper>::writeInsChanged, persist);
-            });
-            contest->setCurrentDecision(decision);
+        auto promise = fetchContests(kj::heapArray({contestId.bytes()})).then(
+                           [this, contestId](kj::Array<kj::Maybe<FetchedContest>> results) {
+            auto& r = KJ_REQUIRE_NONNULL(results[0], "Could not find the specified contest",
+                                         contestId.toString().toStdString());
+            auto contest = wrapContest(kj::mv(r));
+            restorePersistedDecisions({contest});
             return contest;
         });
         return promiseConverter.convert(kj::mv(promise), [](ContestWrapper* contest) -> QVariantList {
@@ -236,6 +206,126 @@ Promise* ChainAdaptorWrapper::getContest(QString contestId)
     return nullptr;
 }
 
+Promise* ChainAdaptorWrapper::getContests(QVariantList contestIds)
+{
+    if (hasAdaptor()) {
+        auto realContestIds = KJ_MAP(id, contestIds) { return id.value<BinaryId>().bytes(); };
+        return promiseConverter.convert(_getContests(kj::mv(realContestIds)),
+                                        [](QList<ContestWrapper*> contests) -> QVariantList {
+            QVariantList list;
+            for (auto contest : contests)
+                list.append(QVariant::fromValue<QObject*>(contest));
+            return {QVariant(list)};
+        });
+    }
+    return nullptr;
+}
+
+kj::Promise<QList<ContestWrapper*>> ChainAdaptorWrapper::_getContests(kj::Array<QByteArray> contestIds)
+{
+    if (!hasAdaptor()) return KJ_EXCEPTION(FAILED, "No blockchain adaptor is set.");
+
+    return fetchContests(kj::mv(contestIds)).then([this](kj::Array<kj::Maybe<FetchedContest>> results) {
+        QList<ContestWrapper*> contests;
+        for (auto& result : results) {
+            KJ_IF_MAYBE(r, result)
+                contests.append(wrapContest(kj::mv(*r)));
+            else
+                contests.append(nullptr);
+        }
+        restorePersistedDecisions(contests);
+        return contests;
+    });
+}
+
+kj::Promise<kj::Array<kj::Maybe<ChainAdaptorWrapper::FetchedContest>>>
+ChainAdaptorWrapper::fetchContests(kj::Array<QByteArray> contestIds)
+{
+    bool allCached = true;
+    auto cached = KJ_MAP(id, contestIds) -> kj::Maybe<FetchedContest> {
+        KJ_IF_MAYBE(contest, cache.get<::Contest>(ResponseCache::Kind::Contest, id))
+            return FetchedContest{contest->reader, kj::mv(contest->keepAlive)};
+        allCached = false;
+        return nullptr;
+    };
+
+    // Always ask the chain; it either supplies the contests we're missing or revalidates the ones we have
+    auto request = m_adaptor->getContests(kj::heapArray<QByteArray>(contestIds.begin(), contestIds.size()));
+    auto fetch = request.then(
+                     [this, ids = kj::mv(contestIds)](kj::Array<kj::Maybe<::Contest::Reader>> results) {
+        for (uint i = 0; i < results.size(); ++i)
+            KJ_IF_MAYBE(contest, results[i])
+                cache.put<::Contest>(ResponseCache::Kind::Contest, ids[i], *contest);
+        return KJ_MAP(result, results) -> kj::Maybe<FetchedContest> {
+            KJ_IF_MAYBE(contest, result)
+                return FetchedContest{*contest, nullptr};
+            return nullptr;
+        };
+    });
+
+    if (!allCached)
+        return kj::mv(fetch);
+    // The contests returned from the cache are not updated by this; they stay as cached until they're fetched again
+    promiseConverter.adopt(fetch.then([](kj::Array<kj::Maybe<FetchedContest>>) {}));
+    return kj::mv(cached);
+}
+
+ContestWrapper* ChainAdaptorWrapper::wrapContest(FetchedContest r)
+{
+    //TODO: Check signature
+    auto contest = new ContestWrapper(r.reader.getContest(), nullptr, kj::mv(r.keepAlive));
+    QQmlEngine::setObjectOwnership(contest, QQmlEngine::JavaScriptOwnership);
+    contest->setCurrentDecision(new OwningWrapper<DecisionWrapper>(contest));
+    return contest;
+}
+
+void ChainAdaptorWrapper::restorePersistedDecisions(QList<ContestWrapper*> contests)
+{
+    // Defer persistence concerns until later; the contests don't know about the QML engine yet so we can't manipulate
+    // the QJSValue properties. One deferred call and one store lookup serve the whole batch. The contests are guarded,
+    // as an owner such as the feed model may already have discarded some of them.
+    QList<QPointer<ContestWrapper>> guardedContests;
+    for (auto contest : contests)
+        guardedContests.append(contest);
+    QTimer::singleShot(0, this, [this, guardedContests]() {
+        QList<QByteArray> contestIds;
+        for (auto contest : guardedContests)
+            if (contest != nullptr)
+                contestIds.append(contest->id().bytes());
+        auto persistedDecisions = decisionStore.get(contestIds);
+
+        for (ContestWrapper* contest : guardedContests) {
+            if (contest == nullptr)
+                continue;
+
+            auto decision = contest->currentDecision();
+            auto contestId = contest->id().bytes();
+            auto bytes = persistedDecisions.value(contestId);
+            if (!bytes.isEmpty()) {
+                try {
+                    decision = OwningWrapper<DecisionWrapper>::deserialize(bytes, contest);
+                    contest->setCurrentDecision(decision);
+                } catch (kj::Exception e) {
+                    emit error(tr("Error when recovering decision: %1")
+                               .arg(QString::fromStdString(e.getDescription())));
+                }
+            }
+            // Serialize once per burst of edits: each change schedules a persist, and the first to run finds the
+            // decision dirty and stores it, leaving the rest nothing to do. The store batches the disk writes.
+            auto persist = [this, contestId, decision] {
+                QTimer::singleShot(0, decision, [this, contestId, decision] {
+                    if (!decision->isDirty())
+                        return;
+                    decisionStore.put(contestId, decision->serialize());
+                    decision->markClean();
+                });
+            };
+            connect(decision, &OwningWrapper<DecisionWrapper>::opinionsChanged, this, persist);
+            connect(decision, &OwningWrapper<DecisionWrapper>::writeInsChanged, this, persist);
+        }
+    });
+}
+
 Datagram::Builder ChainAdaptorWrapper::getNewDatagram()
 {
     if (hasAdaptor())
@@ -41,6 +41,8 @@ class PromiseConverter;
 namespace swv {
 
 class BalanceWrapper;
+class ResponseCache;
+class DecisionStore;
 
 /**
  * @brief The ChainAdaptorWrapper class wraps a BlockchainAdaptorInterface in a more QML-friendly interface
@@ -57,7 +59,8 @@ class ChainAdaptorWrapper : public QObject
     Q_PROPERTY(bool hasAdaptor READ hasAdaptor NOTIFY hasAdaptorChanged)
 
 public:
-    ChainAdaptorWrapper(PromiseConverter& promiseConverter, QObject *parent = 0);
+    ChainAdaptorWrapper(PromiseConverter& promiseConverter, ResponseCache& cache, DecisionStore& decisionStore,
+                        QObject *parent = 0);
     ~ChainAdaptorWrapper() noexcept;
 
     /**
@@ -126,7 +129,23 @@ public:
      *
      * The returned contest will have its currentDecision set
      */
-    Q_INVOKABLE Promise* getContest(QString contestId);
+    Q_INVOKABLE Promise* getContest(swv::BinaryId contestId);
+    /**
+     * @brief Get several contests at once
+     * @param contestIds IDs of the contests to retrieve, as BinaryIds (hex strings are also accepted)
+     * @return Promise for a list of contests, in the same order as the IDs. A contest which is not found is null.
+     *
+     * This resolves a whole page of contests with a single adaptor lookup and a single promise. The returned contests
+     * will have their currentDecisions set.
+     *
+     * If all of the contests are in the response cache, the promise resolves from the cache immediately, and the
+     * contests are revalidated against the chain in the background. Revalidation only refreshes the cache, not the
+     * contests already returned, so a contest from the cache may stay stale until it is next fetched.
+     */
+    Q_INVOKABLE Promise* getContests(QVariantList contestIds);
+    /// @brief Identical to getContests, but returns a kj::Promise instead of a Promise*. For C++ use.
+    /// The returned contests are owned by the JavaScript engine; the caller may take ownership of them instead.
+    kj::Promise<QList<ContestWrapper*>> _getContests(kj::Array<QByteArray> contestIds);
 
     /**
      * @brief Get the on-chain decision for the specified owner and contest
@@ -142,9 +161,9 @@ public:
      * Avoid calling this function frequently for the same decision as it does not implement any cacheing, so it may be
      * slow and will construct a new Decision on each call.
      */
-    Q_INVOKABLE Promise* getDecision(QString owner, QString contestId);
+    Q_INVOKABLE Promise* getDecision(QString owner, swv::BinaryId contestId);
     /// @brief Identical to getDecision, but returns a kj::Promise instead of a Promise*. For C++ use.
-    kj::Promise<OwningWrapper<DecisionWrapper>*> _getDecision(QString owner, QString contestId);
+    kj::Promise<OwningWrapper<DecisionWrapper>*> _getDecision(QString owner, BinaryId contestId);
 
     /**
      * @brief Get a new datagram
@@ -177,11 +196,22 @@ signals:
     /// correctly to not be counted correctly anymore. Possible causes include the decision going stale because it's
     /// balance was destroyed, the contest's owner acquired a new balance in the relevant coin, the decision being
     /// forked out of the blockchain, etc.
-    void contestActionRequired(QString contestId);
+    void contestActionRequired(swv::BinaryId contestId);
 
 private:
     PromiseConverter& promiseConverter;
+    ResponseCache& cache;
+    DecisionStore& decisionStore;
     kj::Own<BlockchainAdaptorInterface> m_adaptor;
+
+    // A fetched contest, and whatever keeps its reader valid (null if the adaptor's data outlives the contest)
+    struct FetchedContest {
+        ::Contest::Reader reader;
+        std::shared_ptr<const void> keepAlive;
+    };
+    kj::Promise<kj::Array<kj::Maybe<FetchedContest>>> fetchContests(kj::Array<QByteArray> contestIds);
+    ContestWrapper* wrapContest(FetchedContest contest);
+    void restorePersistedDecisions(QList<ContestWrapper*> contests);
 };
 
 } // namespace swv
@@ -37,8 +37,13 @@ void CoinWrapper::updateFields(Backend::CoinDetails::Reader details) {
     update_contestCount(details.getActiveContestCount());
 
     if (details.getVolumeHistory().isHistory()) {
-        // TODO: copy history into a QLineSeries property
-        // Will do when we integrate Qt Charts into the project
+        auto history = details.getVolumeHistory().getHistory();
+        QVariantList histogram;
+        histogram.reserve(history.getHistogram().size());
+        for (auto volume : history.getHistogram())
+            histogram.append(qint64(volume));
+        update_volumeHistory(histogram);
+        update_volumeHistoryEnd(QDateTime::fromMSecsSinceEpoch(history.getHistoryEndTimestamp()));
     }
 }
 
@@ -26,6 +26,8 @@
 
 #include <QObject>
 #include <QUrl>
+#include <QDateTime>
+#include <QVariantList>
 
 namespace swv {
 
@@ -68,6 +70,17 @@ class CoinWrapper : public QObject
      * The URL to the icon to display for this coin (may be empty)
      */
     QML_READONLY_VAR_PROPERTY(QUrl, iconUrl)
+    /*!
+     * \qmlproperty list<int> Coin::volumeHistory
+     * Hourly voting volume, oldest first, with the last sample at volumeHistoryEnd. This is not fetched with the coin
+     * list; it is empty until loaded with VotingSystem.loadVolumeHistory
+     */
+    QML_READONLY_VAR_PROPERTY(QVariantList, volumeHistory)
+    /*!
+     * \qmlproperty date Coin::volumeHistoryEnd
+     * The timestamp of the last sample in volumeHistory
+     */
+    QML_READONLY_VAR_PROPERTY(QDateTime, volumeHistoryEnd)
 public:
     CoinWrapper(QObject* parent = nullptr);
 
@@ -79,6 +92,8 @@ public:
     /*!
      * \brief Update the fields on the Coin
      * \param details The new details
+     *
+     * If the details carry no volume history, any previously loaded history is retained.
      */
     void updateFields(Backend::CoinDetails::Reader details);
 };
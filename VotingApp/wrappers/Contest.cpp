@@ -23,39 +23,15 @@
 
 namespace swv {
 
-ContestWrapper::ContestWrapper(UnsignedContest::Reader r, QObject* parent)
+ContestWrapper::ContestWrapper(UnsignedContest::Reader r, QObject* parent, std::shared_ptr<const void> storage)
     : QObject(parent),
-      ::UnsignedContest::Reader(r)
+      ::UnsignedContest::Reader(r),
+      m_id(r.getId()),
+      m_tags(new TextMapModel(r.getTags(), "key", "value", this)),
+      m_contestants(new TextMapModel(r.getContestants(), "name", "description", this)),
+      m_storage(kj::mv(storage))
 {}
 
-QString ContestWrapper::id() const
-{
-    auto data = getId();
-    return QByteArray::fromRawData(reinterpret_cast<const char*>(data.begin()),
-                                   static_cast<signed>(data.size())).toHex();
-}
-
-QVariantMap ContestWrapper::tags() const
-{
-    QVariantMap results;
-    auto tagList = getTags().getEntries();
-    for (auto tag : tagList)
-        results[QString::fromStdString(tag.getKey())] = QString::fromStdString(tag.getValue());
-    return results;
-}
-
-QVariantList ContestWrapper::contestants() const
-{
-    QVariantList results;
-    auto contestantList = getContestants().getEntries();
-    for (auto contestant : contestantList)
-        results.append(QVariantMap({{QStringLiteral("name"),
-                                     QString::fromStdString(contestant.getKey())},
-                                    {QStringLiteral("description"),
-                                     QString::fromStdString(contestant.getValue())}}));
-    return results;
-}
-
 QDateTime ContestWrapper::startTime() const
 {
     return QDateTime::fromMSecsSinceEpoch(getStartTime());
@@ -21,12 +21,16 @@
 
 #include "OwningWrapper.hpp"
 #include "Decision.hpp"
+#include "TextMapModel.hpp"
+#include "BinaryId.hpp"
 
 #include <contest.capnp.h>
 
 #include <QObject>
 #include <QDateTime>
 
+#include <memory>
+
 namespace swv {
 
 /**
@@ -40,30 +44,43 @@ class ContestWrapper : public QObject, public ::UnsignedContest::Reader
 {
 private:
     Q_OBJECT
-    Q_PROPERTY(QString id READ id CONSTANT)
+    Q_PROPERTY(swv::BinaryId id READ id CONSTANT)
     Q_PROPERTY(QString name READ name CONSTANT)
     Q_PROPERTY(QString description READ description CONSTANT)
-    Q_PROPERTY(QVariantMap tags READ tags CONSTANT)
-    Q_PROPERTY(QVariantList contestants READ contestants CONSTANT)
+    Q_PROPERTY(swv::TextMapModel* tags READ tags CONSTANT)
+    Q_PROPERTY(swv::TextMapModel* contestants READ contestants CONSTANT)
     Q_PROPERTY(quint64 coin READ getCoin CONSTANT)
     Q_PROPERTY(QDateTime startTime READ startTime CONSTANT)
     Q_PROPERTY(swv::DecisionWrapper* currentDecision READ currentDecision WRITE setCurrentDecision NOTIFY currentDecisionChanged)
 
     OwningWrapper<DecisionWrapper>* m_currentDecision = nullptr;
+    BinaryId m_id;
+    TextMapModel* m_tags;
+    TextMapModel* m_contestants;
+    std::shared_ptr<const void> m_storage;
 
 public:
-    ContestWrapper(::UnsignedContest::Reader r, QObject* parent = nullptr);
+    /// @param storage Whatever keeps r valid, if it is not otherwise guaranteed to outlive the wrapper
+    ContestWrapper(::UnsignedContest::Reader r, QObject* parent = nullptr, std::shared_ptr<const void> storage = {});
 
-    // Hexadecimal string containing the ID of the contest
-    QString id() const;
+    // ID of the contest
+    const BinaryId& id() const {
+        return m_id;
+    }
     QString name() const {
         return QString::fromStdString(getName());
     }
     QString description() const {
         return QString::fromStdString(getDescription());
     }
-    QVariantMap tags() const;
-    QVariantList contestants() const;
+    // Model of the tags, with roles "key" and "value"
+    TextMapModel* tags() const {
+        return m_tags;
+    }
+    // Model of the contestants, with roles "name" and "description"
+    TextMapModel* contestants() const {
+        return m_contestants;
+    }
     QDateTime startTime() const;
 
     OwningWrapper<DecisionWrapper>* currentDecision();
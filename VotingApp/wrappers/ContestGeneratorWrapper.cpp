@@ -1,16 +1,97 @@
 #include "ContestGeneratorWrapper.hpp"
+#include "BackendWrapper.hpp"
 
 #include "Converters.hpp"
 
 #include <kj/debug.h>
 
+#include <QPointer>
+
 namespace swv {
 
-ContestGeneratorWrapper::ContestGeneratorWrapper(ContestGenerator::Client generator,
+class ContestGeneratorWrapper::GeneratorState {
+public:
+    GeneratorState(GeneratorFactory factory, BackendWrapper& backend)
+        : factory(kj::mv(factory)),
+          backend(&backend),
+          generator(this->factory(backend.backend())),
+          epoch(backend.connectionEpoch())
+    {}
+
+    GeneratorFactory factory;
+    QPointer<BackendWrapper> backend;
+    ContestGenerator::Client generator;
+    // The connection epoch the generator was obtained on
+    quint64 epoch;
+    // Number of contests delivered to the caller so far; a re-created generator is advanced past these
+    qint64 position = 0;
+    // The advance of the current generator past position, if it was re-created. Every request on the generator waits
+    // on this, so requests are sent, and answered, in the order they were made.
+    kj::Maybe<kj::ForkedPromise<void>> advance;
+
+    /// Whether a failure on the current generator should be replayed once the backend comes back
+    bool shouldReplay(const kj::Exception& e) const {
+        if (backend.isNull())
+            return false;
+        // A call that went out on a connection that has since been replaced or lost fails with whatever error the
+        // RPC system tore it down with, so don't rely solely on the exception type.
+        return e.getType() == kj::Exception::Type::DISCONNECTED ||
+                !backend->isConnected() || epoch != backend->connectionEpoch();
+    }
+
+    /// Re-create the generator if it belongs to a dead connection, and skip the contests we've already delivered
+    kj::Promise<void> rebind() {
+        if (backend.isNull())
+            return KJ_EXCEPTION(DISCONNECTED, "Backend is gone; cannot re-create contest generator");
+        if (epoch != backend->connectionEpoch()) {
+            generator = factory(backend->backend());
+            epoch = backend->connectionEpoch();
+            advance = nullptr;
+            if (position > 0) {
+                // The server skips the contests itself, so none of them are sent again
+                KJ_LOG(DBG, "Advancing re-created generator", position);
+                auto request = generator.skipRequest();
+                request.setCount(position);
+                advance = request.send().then([](capnp::Response<ContestGenerator::SkipResults>) {}).fork();
+            }
+        }
+
+        KJ_IF_MAYBE(pending, advance)
+            return pending->addBranch();
+        return kj::READY_NOW;
+    }
+};
+
+namespace {
+template <typename Results>
+using Sender = std::function<kj::Promise<capnp::Response<Results>>(ContestGenerator::Client&)>;
+
+/// Send a request on the generator, and if the connection drops before it completes, replay it on a re-created
+/// generator when the backend reconnects. Only reads are sent this way; the generator position makes them idempotent.
+template <typename Results>
+kj::Promise<capnp::Response<Results>> sendWithReplay(std::shared_ptr<ContestGeneratorWrapper::GeneratorState> state,
+                                                     Sender<Results> send) {
+    return state->rebind().then([state, send]() { return send(state->generator); }).then(
+                [](capnp::Response<Results>&& response) -> kj::Promise<capnp::Response<Results>> {
+        return kj::mv(response);
+    }, [state, send](kj::Exception&& e) -> kj::Promise<capnp::Response<Results>> {
+        if (!state->shouldReplay(e))
+            return kj::mv(e);
+
+        KJ_LOG(INFO, "Contest generator request interrupted by disconnection; will replay", e);
+        return state->backend->whenConnected().then([state, send](Backend::Client) {
+            return sendWithReplay<Results>(state, send);
+        });
+    });
+}
+} // anonymous namespace
+
+ContestGeneratorWrapper::ContestGeneratorWrapper(GeneratorFactory factory,
+                                                 BackendWrapper& backend,
                                                  PromiseConverter& converter,
                                                  QObject *parent)
     : QObject(parent),
-      generator(generator),
+      state(std::make_shared<GeneratorState>(kj::mv(factory), backend)),
       converter(converter)
 {}
 
@@ -19,25 +100,52 @@ ContestGeneratorWrapper::~ContestGeneratorWrapper() noexcept
 
 Promise* ContestGeneratorWrapper::getContest()
 {
-    return converter.convert(generator.getContestRequest().send(),
-                              [](capnp::Response<ContestGenerator::GetContestResults> response) -> QVariantList {
-        return {convertListedContest(response.getNextContest())};
+    using Results = ContestGenerator::GetContestResults;
+    auto state = this->state;
+    auto promise = sendWithReplay<Results>(state, [](ContestGenerator::Client& generator) {
+        return generator.getContestRequest().send();
+    }).then([state](capnp::Response<Results>&& response) {
+        ++state->position;
+        return kj::mv(response);
+    });
+
+    return converter.convert(kj::mv(promise), [](capnp::Response<Results> r) -> QVariantList {
+        return {convertListedContest(r.getNextContest())};
     });
 }
 
 Promise* ContestGeneratorWrapper::getContests(int count)
 {
-    KJ_LOG(DBG, "Requesting contests", count);
-    auto request = generator.getContestsRequest();
-    request.setCount(count);
-
-    return converter.convert(request.send(),
-                              [](capnp::Response<ContestGenerator::GetContestsResults> r) -> QVariantList {
+    using Results = ContestGenerator::GetContestsResults;
+    auto span = Tracer::begin("ContestGeneratorWrapper::getContests");
+    auto trace = span.context();
+    auto promise = _getContests(count, span).attach(kj::mv(span));
+    return converter.convert(kj::mv(promise), [](capnp::Response<Results> r) -> QVariantList {
         KJ_LOG(DBG, "Got contests", r.getNextContests().size());
         QVariantList contests;
         for (auto contest : r.getNextContests())
             contests.append(convertListedContest(contest));
         return {QVariant(contests)};
+    }, trace);
+}
+
+kj::Promise<capnp::Response<ContestGenerator::GetContestsResults>>
+ContestGeneratorWrapper::_getContests(int count, const Tracer::Span& parent)
+{
+    using Results = ContestGenerator::GetContestsResults;
+    KJ_LOG(DBG, "Requesting contests", count);
+    auto state = this->state;
+    // Shared, as the sender may be copied to replay the request
+    auto span = std::make_shared<Tracer::Span>(Tracer::begin("ContestGeneratorWrapper::_getContests", parent));
+    return sendWithReplay<Results>(state, [count, span](ContestGenerator::Client& generator) {
+        auto request = generator.getContestsRequest();
+        request.setCount(count);
+        span->propagate(request.initTrace());
+        return request.send();
+    }).then([state, span](capnp::Response<Results>&& response) {
+        span->end();
+        state->position += response.getNextContests().size();
+        return kj::mv(response);
     });
 }
 
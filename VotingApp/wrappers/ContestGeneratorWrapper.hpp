@@ -2,25 +2,51 @@
 #define CONTESTGENERATORWRAPPER_HPP
 
 #include <contestgenerator.capnp.h>
+#include <backend.capnp.h>
 
 #include "PromiseConverter.hpp"
 
 #include <Promise.hpp>
+#include <Tracer.hpp>
 
-namespace swv {
+#include <functional>
+#include <memory>
 
+namespace swv {
+class BackendWrapper;
+
+/**
+ * @brief The ContestGeneratorWrapper class provides a QML-friendly wrapper for a ContestGenerator
+ *
+ * The wrapper does not hold the generator capability directly; rather, it holds a factory which obtains a generator
+ * from a backend client. If the connection to the backend is lost, requests in flight on the old generator wait for
+ * the BackendWrapper to reconnect, after which the generator is re-created, advanced past the contests already
+ * delivered, and the requests are replayed. Callers see only a delayed response.
+ */
 class ContestGeneratorWrapper : public QObject
 {
     Q_OBJECT
 
-    ContestGenerator::Client generator;
-    PromiseConverter& converter;
 public:
-    ContestGeneratorWrapper(ContestGenerator::Client generator, PromiseConverter& converter, QObject *parent = 0);
+    using GeneratorFactory = std::function<ContestGenerator::Client(Backend::Client)>;
+
+    ContestGeneratorWrapper(GeneratorFactory factory, BackendWrapper& backend, PromiseConverter& converter,
+                            QObject *parent = 0);
     virtual ~ContestGeneratorWrapper() noexcept;
 
     Q_INVOKABLE Promise* getContest();
     Q_INVOKABLE Promise* getContests(int count);
+    /// @brief Identical to getContests, but returns the response instead of a Promise*. For C++ use.
+    /// @param parent The span the request is part of. The request's span, and the server's, are recorded under it.
+    kj::Promise<capnp::Response<ContestGenerator::GetContestsResults>> _getContests(int count,
+                                                                                    const Tracer::Span& parent = {});
+
+    class GeneratorState;
+
+private:
+    // Shared with the promises in flight, so a replay can complete even if QML collects this wrapper meanwhile
+    std::shared_ptr<GeneratorState> state;
+    PromiseConverter& converter;
 };
 
 }
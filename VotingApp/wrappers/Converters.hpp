@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include "BinaryId.hpp"
+
 #include <QByteArray>
 #include <QVariantMap>
 
@@ -26,6 +28,13 @@
 inline QByteArray convertBlob(capnp::Data::Reader data) {
     return QByteArray(reinterpret_cast<const char*>(data.begin()), static_cast<signed>(data.size()));
 }
+/// Get a non-owning QByteArray view of a capnp::Data::Reader, without copying the data.
+/// @warning The returned byte array references the message's memory! It is only valid as long as the message backing
+/// the reader is, so do not store it; use convertBlob (or swv::BinaryId, for IDs) for anything which must outlive the
+/// message. Only read the view through const methods, as anything non-const makes QByteArray copy the data anyway.
+inline QByteArray convertBlobView(capnp::Data::Reader data) {
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(data.begin()), static_cast<signed>(data.size()));
+}
 /// Convert a QByteArray into a capnp::Data::Builder.
 /// @warning The returned builder just references the QByteArray's memory! Do not change or deallocate the byte array
 /// while the returned Builder exists.
@@ -33,12 +42,44 @@ inline capnp::Data::Builder convertBlob(QByteArray& data) {
     return capnp::Data::Builder(reinterpret_cast<kj::byte*>(data.data()), data.size());
 }
 inline QVariantMap convertListedContest(ContestGenerator::ListedContest::Reader contest) {
-    return {{"contestId", QString(convertBlob(contest.getContestId()).toHex())},
+    return {{"contestId", QVariant::fromValue(swv::BinaryId(contest.getContestId()))},
             {"votingStake", qint64(contest.getVotingStake())},
             {"tracksLiveResults", contest.getTracksLiveResults()}};
 }
 inline QString convertText(capnp::Text::Reader text) {
-    return QString::fromStdString(text);
+    return QString::fromUtf8(text.cStr(), static_cast<int>(text.size()));
+}
+inline QVariantMap convertArenaStats(Stats::ArenaStats::Reader arena) {
+    return {{"name", convertText(arena.getName())},
+            {"messageCount", arena.getMessageCount()},
+            {"segmentCount", quint64(arena.getSegmentCount())},
+            {"bytesAllocated", quint64(arena.getBytesAllocated())},
+            {"bytesUsed", quint64(arena.getBytesUsed())},
+            {"bytesReachable", quint64(arena.getBytesReachable())},
+            {"bytesOrphaned", quint64(arena.getBytesOrphaned())}};
+}
+inline QVariantMap convertHistogram(Stats::Histogram::Reader histogram) {
+    QVariantList buckets;
+    for (auto bucket : histogram.getBuckets())
+        buckets.append(quint64(bucket));
+    return {{"buckets", buckets},
+            {"count", quint64(histogram.getCount())},
+            {"sum", quint64(histogram.getSum())},
+            {"max", quint64(histogram.getMax())}};
+}
+/// Convert the loops and task sets of a Stats into a map of two lists, "loops" and "taskSets"
+inline QVariantMap convertLoopStats(Stats::Reader stats) {
+    QVariantList loops;
+    for (auto loop : stats.getLoops())
+        loops.append(QVariantMap{{"name", convertText(loop.getName())},
+                                 {"turnMicros", convertHistogram(loop.getTurnMicros())},
+                                 {"lagMicros", convertHistogram(loop.getLagMicros())}});
+    QVariantList taskSets;
+    for (auto taskSet : stats.getTaskSets())
+        taskSets.append(QVariantMap{{"name", convertText(taskSet.getName())},
+                                    {"size", quint64(taskSet.getSize())},
+                                    {"sizes", convertHistogram(taskSet.getSizes())}});
+    return {{"loops", loops}, {"taskSets", taskSets}};
 }
 inline kj::String convertText(QString source) {
     return kj::heapString(source.toStdString());
@@ -23,14 +23,12 @@
 
 #include <kj/common.h>
 
+#include <algorithm>
+
 #include <QDebug>
 #include <QJSEngine>
 #include <QJSValueIterator>
 
-#define convert(name) \
-    auto data = reader().get ## name (); \
-    return QByteArray::fromRawData(reinterpret_cast<const char*>(data.begin()), data.size()).toHex()
-
 namespace swv {
 
 DecisionWrapper::DecisionWrapper(WrappedType::Builder b, QObject* parent)
@@ -41,14 +39,14 @@ DecisionWrapper::DecisionWrapper(WrappedType::Builder b, QObject* parent)
 DecisionWrapper::~DecisionWrapper() noexcept
 {}
 
-QString DecisionWrapper::id() const
+BinaryId DecisionWrapper::id() const
 {
-    convert(Id);
+    return BinaryId(reader().getId());
 }
 
-QString DecisionWrapper::contestId() const
+BinaryId DecisionWrapper::contestId() const
 {
-    convert(Contest);
+    return BinaryId(reader().getContest());
 }
 
 QVariantMap DecisionWrapper::opinions() const
@@ -57,7 +55,8 @@ QVariantMap DecisionWrapper::opinions() const
 
     QVariantMap results;
     for (::Decision::Opinion::Reader opinion : data)
-        results.insert(QString::number(opinion.getContestant()), opinion.getOpinion());
+        if (opinion.getOpinion() != 0)
+            results.insert(QString::number(opinion.getContestant()), opinion.getOpinion());
     return results;
 }
 
@@ -83,24 +82,103 @@ QVariantMap DecisionWrapper::canonicalizeOpinions(QVariantMap opinions)
     return opinions;
 }
 
+qint32 DecisionWrapper::opinion(qint32 contestant) const
+{
+    for (::Decision::Opinion::Reader opinion : reader().getOpinions())
+        if (opinion.getOpinion() != 0 && opinion.getContestant() == contestant)
+            return opinion.getOpinion();
+    return 0;
+}
+
+void DecisionWrapper::setOpinion(qint32 contestant, qint32 opinion)
+{
+    if (!applyOpinion(contestant, opinion))
+        return;
+
+    dirty = true;
+    emit opinionsChanged();
+}
+
 void DecisionWrapper::setOpinions(QVariantMap newOpinions)
 {
     newOpinions = canonicalizeOpinions(kj::mv(newOpinions));
 
-    if (newOpinions == opinions())
+    // Clear the opinions which aren't in the new set, then apply the new set, all in place
+    bool changed = false;
+    for (::Decision::Opinion::Reader opinion : reader().getOpinions())
+        if (opinion.getOpinion() != 0 && !newOpinions.contains(QString::number(opinion.getContestant())))
+            changed |= applyOpinion(opinion.getContestant(), 0);
+    for (auto itr = newOpinions.begin(); itr != newOpinions.end(); ++itr)
+        changed |= applyOpinion(itr.key().toInt(), itr.value().toInt());
+
+    if (!changed)
         return;
 
-    // Now we actually allocate space for and set the opinions
-    auto opinionList = m_decision.initOpinions(newOpinions.size());
-    unsigned currentIndex = 0;
-    while (!newOpinions.empty()) {
-        auto builder = opinionList[currentIndex++];
-        auto key = newOpinions.firstKey();
-        builder.setContestant(key.toInt());
-        builder.setOpinion(newOpinions.take(key).toInt());
+    dirty = true;
+    emit opinionsChanged();
+}
+
+bool DecisionWrapper::applyOpinion(qint32 contestant, qint32 opinion)
+{
+    auto opinions = m_decision.getOpinions();
+    kj::Maybe<uint> freeSlot;
+    for (uint i = 0; i < opinions.size(); ++i) {
+        auto slot = opinions[i];
+        if (slot.getOpinion() == 0) {
+            if (freeSlot == nullptr)
+                freeSlot = i;
+            continue;
+        }
+        if (slot.getContestant() == contestant) {
+            if (slot.getOpinion() == opinion)
+                return false;
+            // Setting zero frees the slot
+            slot.setOpinion(opinion);
+            return true;
+        }
     }
 
-    emit opinionsChanged();
+    if (opinion == 0)
+        return false;
+    KJ_IF_MAYBE(index, freeSlot) {
+        opinions[*index].setContestant(contestant);
+        opinions[*index].setOpinion(opinion);
+        return true;
+    }
+
+    // The list is full. Grow it geometrically, so repeated edits abandon a logarithmic number of lists in the message
+    // rather than one per edit.
+    auto oldList = m_decision.disownOpinions();
+    auto oldOpinions = oldList.getReader();
+    auto newOpinions = m_decision.initOpinions(std::max(4u, oldOpinions.size() * 2));
+    for (uint i = 0; i < oldOpinions.size(); ++i) {
+        newOpinions[i].setContestant(oldOpinions[i].getContestant());
+        newOpinions[i].setOpinion(oldOpinions[i].getOpinion());
+    }
+    newOpinions[oldOpinions.size()].setContestant(contestant);
+    newOpinions[oldOpinions.size()].setOpinion(opinion);
+    return true;
+}
+
+void DecisionWrapper::copyCompacted(::Decision::Reader source, ::Decision::Builder target)
+{
+    target.setId(source.getId());
+    target.setContest(source.getContest());
+    target.setWriteIns(source.getWriteIns());
+
+    auto opinions = source.getOpinions();
+    uint liveCount = 0;
+    for (auto opinion : opinions)
+        if (opinion.getOpinion() != 0)
+            ++liveCount;
+
+    auto compacted = target.initOpinions(liveCount);
+    uint index = 0;
+    for (auto opinion : opinions)
+        if (opinion.getOpinion() != 0) {
+            compacted[index].setContestant(opinion.getContestant());
+            compacted[index++].setOpinion(opinion.getOpinion());
+        }
 }
 
 void DecisionWrapper::setWriteIns(QVariantList newWriteIns)
@@ -115,6 +193,7 @@ void DecisionWrapper::setWriteIns(QVariantList newWriteIns)
         writeInBuilder.setValue(writeIn["description"].toString().toStdString());
     }
 
+    dirty = true;
     emit writeInsChanged();
 }
 
@@ -19,6 +19,8 @@
 #ifndef DECISION_HPP
 #define DECISION_HPP
 
+#include "BinaryId.hpp"
+
 #include <decision.capnp.h>
 
 #include <capnp/message.h>
@@ -30,6 +32,10 @@ namespace swv {
 
 /**
  * @brief The DecisionWrapper class is a read-write wrapper for the Decision type.
+ *
+ * Opinions are edited in place. An opinion of zero is no opinion, so clearing an opinion just zeroes its slot, and
+ * setting a new one reuses a zeroed slot if there is one; the list is only reallocated, with room to spare, when it is
+ * full. The working message may therefore contain empty slots, which @ref copyCompacted leaves out.
  */
 class DecisionWrapper : public QObject
 {
@@ -38,19 +44,35 @@ class DecisionWrapper : public QObject
 public:
     using WrappedType = ::Decision;
 
-    Q_PROPERTY(QString id READ id CONSTANT)
-    Q_PROPERTY(QString contestId READ contestId CONSTANT)
+    Q_PROPERTY(swv::BinaryId id READ id CONSTANT)
+    Q_PROPERTY(swv::BinaryId contestId READ contestId CONSTANT)
     Q_PROPERTY(QVariantMap opinions READ opinions WRITE setOpinions NOTIFY opinionsChanged)
     Q_PROPERTY(QVariantList writeIns READ writeIns WRITE setWriteIns NOTIFY writeInsChanged)
 
     DecisionWrapper(WrappedType::Builder b, QObject* parent = nullptr);
     ~DecisionWrapper() noexcept;
 
-    QString id() const;
-    QString contestId() const;
+    BinaryId id() const;
+    BinaryId contestId() const;
     QVariantMap opinions() const;
     QVariantList writeIns() const;
 
+    /// @brief Get the opinion on the specified contestant; zero if there is none
+    Q_INVOKABLE qint32 opinion(qint32 contestant) const;
+    /// @brief Set the opinion on a single contestant, leaving the others untouched. Zero clears the opinion.
+    Q_INVOKABLE void setOpinion(qint32 contestant, qint32 opinion);
+
+    /// @brief Check whether the decision has changed since it was created or last marked clean
+    bool isDirty() const {
+        return dirty;
+    }
+    void markClean() {
+        dirty = false;
+    }
+
+    /// @brief Copy a decision, leaving out the empty opinion slots left behind by in-place edits
+    static void copyCompacted(::Decision::Reader source, ::Decision::Builder target);
+
     ::Decision::Reader reader() const {
         return m_decision.asReader();
     }
@@ -61,7 +83,7 @@ public:
     /// @brief Compare two decisions. Decisions are equal if they apply to the same contest and have the same opinions
     /// and write-ins. The IDs are not relevant to equality.
     bool operator== (const DecisionWrapper& other) {
-        return contestId() == other.contestId() &&
+        return reader().getContest() == other.reader().getContest() &&
                 opinions() == other.opinions() &&
                 writeIns() == other.writeIns();
     }
@@ -81,8 +103,11 @@ signals:
 private:
     /// Remove all opinions of zero
     QVariantMap canonicalizeOpinions(QVariantMap opinions);
+    /// Set the opinion on a contestant without emitting; returns whether anything changed
+    bool applyOpinion(qint32 contestant, qint32 opinion);
 
     ::Decision::Builder m_decision;
+    bool dirty = false;
 };
 
 } // namespace swv
@@ -21,24 +21,50 @@
 #include <capnp/message.h>
 #include <capnp/serialize-packed.h>
 
+#include <TrackingMessageBuilder.hpp>
+
 #include <QObject>
 #include <QByteArray>
 #include <QTimer>
 
+#include <utility>
+
 namespace _ {
 // Implementation detail of OwningWrapper. This class contains an m_message which cannot be a data member of
 // OwningWrapper directly, as it must be constructed prior to calling Wrapper's constructor.
 class MessageStorage {
 protected:
+    /// @param arena Name of the arena to account the message's memory to
+    explicit MessageStorage(const char* arena)
+        : m_message(arena) {}
     virtual ~MessageStorage();
-    capnp::MallocMessageBuilder m_message;
+    swv::TrackingMessageBuilder m_message;
+};
+
+// Implementation detail of OwningWrapper. Copies a wrapper's data into target as it is.
+template <typename Wrapper, typename = void>
+struct SerializationCopier {
+    static void copy(capnp::ReaderFor<typename Wrapper::WrappedType> source, capnp::MessageBuilder& target) {
+        target.setRoot(source);
+    }
+};
+// Wrappers which provide a copyCompacted use it instead, to leave out the slack their in-place editing leaves behind
+template <typename Wrapper>
+struct SerializationCopier<Wrapper, decltype(Wrapper::copyCompacted(
+        std::declval<capnp::ReaderFor<typename Wrapper::WrappedType>>(),
+        std::declval<capnp::BuilderFor<typename Wrapper::WrappedType>>()), void())> {
+    static void copy(capnp::ReaderFor<typename Wrapper::WrappedType> source, capnp::MessageBuilder& target) {
+        Wrapper::copyCompacted(source, target.initRoot<typename Wrapper::WrappedType>());
+    }
 };
 }
 
 /**
  * @brief Decoration on a wrapper type that causes the wrapper to own the underlying message
  *
- * @tparam Wrapper A wrapper type which wraps a capnp data type
+ * @tparam Wrapper A wrapper type which wraps a capnp data type. If it provides a static
+ * copyCompacted(ReaderFor<WrappedType>, BuilderFor<WrappedType>), @ref serialize uses it to write a copy of the data
+ * without whatever slack the wrapper's in-place editing leaves in the message; otherwise the data is copied as is.
  */
 template <typename Wrapper>
 class OwningWrapper : public _::MessageStorage, public Wrapper {
@@ -48,29 +74,41 @@ class OwningWrapper : public _::MessageStorage, public Wrapper {
     }
 
 public:
+    // Each wrapper type's messages are accounted as an arena named for the type
     OwningWrapper(QObject* parent = nullptr)
-        : Wrapper(m_message.initRoot<typename Wrapper::WrappedType>(), parent) {}
+        : _::MessageStorage(Wrapper::staticMetaObject.className()),
+          Wrapper(m_message.initRoot<typename Wrapper::WrappedType>(), parent) {}
     OwningWrapper(capnp::ReaderFor<typename Wrapper::WrappedType> r, QObject* parent = nullptr)
-        : Wrapper(copyData(r), parent) {}
+        : _::MessageStorage(Wrapper::staticMetaObject.className()),
+          Wrapper(copyData(r), parent) {}
     virtual ~OwningWrapper() noexcept {}
 
     QByteArray serialize()
     {
+        // Serialize a copy, in a single segment sized to fit, so that neither the garbage edits leave in the working
+        // message nor (for wrappers which can compact themselves) the wrapper's slack is written out
+        auto root = m_message.getRoot<typename Wrapper::WrappedType>().asReader();
+        capnp::MallocMessageBuilder compacted(static_cast<uint>(root.totalSize().wordCount + 1),
+                                              capnp::AllocationStrategy::FIXED_SIZE);
+        _::SerializationCopier<Wrapper>::copy(root, compacted);
+
         // Future optimization: only allocate the necessary space
         // Right now we allocate enough space for an unpacked message, then write a packed message and shrink to fit
         // When I figure out how to predict the size of a packed message before writing it, I'll fix this
-        QByteArray buffer(capnp::computeSerializedSizeInWords(m_message) * capnp::BYTES_PER_WORD, 0);
+        QByteArray buffer(capnp::computeSerializedSizeInWords(compacted) * capnp::BYTES_PER_WORD, 0);
         kj::ArrayOutputStream arrayStream(kj::ArrayPtr<kj::byte>(reinterpret_cast<unsigned char*>(buffer.data()),
                                                                  static_cast<unsigned>(buffer.size())));
-        capnp::writePackedMessage(arrayStream, m_message);
+        capnp::writePackedMessage(arrayStream, compacted);
         buffer.resize(arrayStream.getArray().size());
         return buffer;
     }
 
     static OwningWrapper* deserialize(QByteArray serial, QObject* parent = nullptr)
     {
-        kj::ArrayInputStream arrayStream(kj::ArrayPtr<kj::byte>(reinterpret_cast<unsigned char*>(serial.data()),
-                                                                static_cast<unsigned>(serial.size())));
+        // Read through constData so that a raw-data view of a message (see convertBlobView) is not copied first
+        kj::ArrayInputStream arrayStream(kj::ArrayPtr<const kj::byte>(
+                                             reinterpret_cast<const unsigned char*>(serial.constData()),
+                                             static_cast<unsigned>(serial.size())));
         capnp::PackedMessageReader reader(arrayStream);
         return new OwningWrapper(reader.getRoot<typename Wrapper::WrappedType>(), parent);
     }
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TextMapModel.hpp"
+#include "Converters.hpp"
+
+#include <algorithm>
+
+namespace swv {
+
+TextMapModel::TextMapModel(Reader map, QByteArray keyRoleName, QByteArray valueRoleName, QObject* parent)
+    : QAbstractListModel(parent),
+      map(map),
+      roles({{KeyRole, keyRoleName}, {ValueRole, valueRoleName}})
+{}
+
+TextMapModel::~TextMapModel() noexcept
+{}
+
+QVariantMap TextMapModel::get(int index) const
+{
+    if (index < 0 || index >= count())
+        return {};
+
+    auto entry = map.getEntries()[index];
+    return {{QString::fromLatin1(roles[KeyRole]), convertText(entry.getKey())},
+            {QString::fromLatin1(roles[ValueRole]), convertText(entry.getValue())}};
+}
+
+QString TextMapModel::value(QString key) const
+{
+    auto utf8Key = key.toUtf8();
+    for (auto entry : map.getEntries()) {
+        // Compare the raw bytes rather than converting every key
+        auto entryKey = entry.getKey();
+        if (entryKey.size() == static_cast<size_t>(utf8Key.size()) &&
+                std::equal(entryKey.begin(), entryKey.end(), utf8Key.constData()))
+            return convertText(entry.getValue());
+    }
+    return {};
+}
+
+int TextMapModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return count();
+}
+
+QVariant TextMapModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= count())
+        return {};
+
+    auto entry = map.getEntries()[index.row()];
+    switch (role) {
+    case KeyRole:
+        return convertText(entry.getKey());
+    case ValueRole:
+        return convertText(entry.getValue());
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> TextMapModel::roleNames() const
+{
+    return roles;
+}
+
+} // namespace swv
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEXTMAPMODEL_HPP
+#define TEXTMAPMODEL_HPP
+
+#include "map.capnp.h"
+
+#include <QAbstractListModel>
+
+namespace swv {
+
+/**
+ * @brief The TextMapModel class is a read-only list model over a capnp Map of Text to Text
+ *
+ * The model reads the entries from the underlying Reader when a view asks for them; it does not copy the map. The
+ * memory backing the Reader must therefore outlive the model, as it does for the wrapper which owns the model.
+ *
+ * Each entry exposes two roles, whose names are chosen at construction: for instance, "name" and "description" for a
+ * contest's contestants. The model has no notion of key uniqueness; use @ref value for lookups by key.
+ */
+class TextMapModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count CONSTANT)
+
+public:
+    using Reader = ::Map<capnp::Text, capnp::Text>::Reader;
+    enum Roles {
+        KeyRole = Qt::UserRole,
+        ValueRole
+    };
+
+    TextMapModel(Reader map, QByteArray keyRoleName = "key", QByteArray valueRoleName = "value",
+                 QObject* parent = nullptr);
+    virtual ~TextMapModel() noexcept;
+
+    int count() const {
+        return map.getEntries().size();
+    }
+
+    /// @brief Get the entry at index as a JS-friendly map of role name to value
+    Q_INVOKABLE QVariantMap get(int index) const;
+    /// @brief Get the value of the first entry having the given key, or an empty string if there is none
+    Q_INVOKABLE QString value(QString key) const;
+
+    // QAbstractItemModel interface
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex& index, int role) const;
+    virtual QHash<int, QByteArray> roleNames() const;
+
+private:
+    Reader map;
+    QHash<int, QByteArray> roles;
+};
+
+} // namespace swv
+
+#endif // TEXTMAPMODEL_HPP
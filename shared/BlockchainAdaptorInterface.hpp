@@ -86,9 +86,31 @@ public:
     /**
      * @brief Get the contest with the specified ID
      * @param contestId ID of the contest to retrieve
-     * @return Promise for the contest having the provided ID. Promise will be broken if contest is not found.
+     * @return Promise for the contest having the provided ID. Promise will be broken with a FAILED exception if the
+     * contest is not found, or with another type of exception (e.g. DISCONNECTED) if the lookup itself fails.
      */
     virtual kj::Promise<Contest::Reader> getContest(QByteArray contestId) const = 0;
+    /**
+     * @brief Get several contests at once
+     * @param contestIds IDs of the contests to retrieve
+     * @return Promise for the contests, in the same order as the IDs. A contest which is not found is null. If the
+     * lookup fails for any other reason, the promise is broken.
+     *
+     * The default implementation simply calls @ref getContest for each ID. Adaptors which can find many contests in a
+     * single lookup pass should override it.
+     */
+    virtual kj::Promise<kj::Array<kj::Maybe<Contest::Reader>>> getContests(kj::Array<QByteArray> contestIds) const {
+        return kj::joinPromises(KJ_MAP(id, contestIds) {
+            return getContest(id).then([](Contest::Reader contest) -> kj::Maybe<Contest::Reader> {
+                return contest;
+            }, [](kj::Exception&& e) -> kj::Maybe<Contest::Reader> {
+                // Only a FAILED lookup means the contest isn't there; a transient error must not look like one
+                if (e.getType() != kj::Exception::Type::FAILED)
+                    kj::throwFatalException(kj::mv(e));
+                return nullptr;
+            });
+        });
+    }
 
     /**
      * @brief Create a datagram for publishing
@@ -112,6 +134,28 @@ public:
      * Datagrams owned by the balance with a distinct type/key will be preserved.
      */
     virtual kj::Promise<void> publishDatagram(QByteArray payerBalance, QByteArray publisherBalance) = 0;
+    /**
+     * @brief Publish a datagram built by the caller to the blockchain
+     * @param payerBalance Balance which will be used to pay for the publication
+     * @param publisherBalance Balance which the datagram will be stored on
+     * @param datagram The datagram to publish. It is copied before this method returns.
+     * @return A promise which will resolve when the datagram is successfully broadcast (not yet confirmed), or broken
+     * in case of an error broadcasting the transaction
+     *
+     * Unlike the overload which publishes the datagram from @ref createDatagram, this keeps no state between calls, so
+     * any number of publications may be in flight at once, and one datagram may be published on many balances.
+     *
+     * The default implementation copies the datagram into the builder from @ref createDatagram and publishes that.
+     * Adaptors should override it to avoid the copy.
+     */
+    virtual kj::Promise<void> publishDatagram(QByteArray payerBalance, QByteArray publisherBalance,
+                                              Datagram::Reader datagram) {
+        auto builder = createDatagram();
+        builder.initIndex().setType(datagram.getIndex().getType());
+        builder.getIndex().setKey(datagram.getIndex().getKey());
+        builder.setContent(datagram.getContent());
+        return publishDatagram(payerBalance, publisherBalance);
+    }
     [[deprecated("Issue #6: Replaced by overload which distinguishes between payer and publisher balances")]]
     virtual kj::Promise<void> publishDatagram(QByteArray payerBalanceId) {
         KJ_LOG(DBG, "Call to deprecated overload of publishDatagram");
@@ -127,17 +171,61 @@ public:
      * @return A promise which resolves when the transaction is successfully broadcast, or breaks if broadcast fails
      */
     virtual kj::Promise<void> transfer(QString sender, QString recipient, qint64 amount, quint64 coinId) = 0;
+    /**
+     * @brief Merge all of an owner's balances in a coin into a single balance
+     * @param owner Name of the account whose balances should be merged (should be one of the names returned by
+     * \ref getMyAccounts)
+     * @param coinId Type of coin whose balances should be merged
+     * @return A promise for the merged balance, which breaks if the owner has no balances in the coin
+     *
+     * Every datagram on the merged balances is carried over to the new balance. Where more than one of them has a
+     * datagram of the same type and key, the one on the newest balance is kept, as that is the one readers of the
+     * balances already treat as current. Afterward, casting a decision in the coin costs one publication rather than
+     * one per balance.
+     *
+     * The default implementation breaks the promise; adaptors which can merge balances should override it.
+     */
+    virtual kj::Promise<Balance::Reader> consolidateBalances(QString owner, quint64 coinId) {
+        return KJ_EXCEPTION(UNIMPLEMENTED, "This chain adaptor cannot consolidate balances",
+                            owner.toStdString(), coinId);
+    }
 
     /**
      * @brief Get the datagram with the specified type and key belonging to the specified balance
      * @param balanceId ID of the balance owning the requested datagram
      * @param type The type of the requested datagram
-     * @param key The key of the requested datagram
-     * @return A promise for the requested datagram. The promise will be broken if no datagram is found.
+     * @param key The key of the requested datagram, in binary
+     * @return A promise for the requested datagram. The promise will be broken with a FAILED exception if no datagram
+     * is found, or with another type of exception (e.g. DISCONNECTED) if the lookup itself fails.
      */
     virtual kj::Promise<Datagram::Reader> getDatagram(QByteArray balanceId,
                                                       Datagram::DatagramType type,
-                                                      QString key) const = 0;
+                                                      QByteArray key) const = 0;
+    /**
+     * @brief Get the datagram with the specified type and key on each of several balances
+     * @param balanceIds IDs of the balances to get datagrams from
+     * @param type The type of the requested datagrams
+     * @param key The key of the requested datagrams, in binary
+     * @return A promise for the datagrams, in the same order as balanceIds. A balance with no such datagram gets null.
+     * If the lookup fails for any other reason, the promise is broken.
+     *
+     * The default implementation calls @ref getDatagram once per balance. Adaptors which can look up several datagrams
+     * at once should override it.
+     */
+    virtual kj::Promise<kj::Array<kj::Maybe<Datagram::Reader>>> getDatagrams(kj::Array<QByteArray> balanceIds,
+                                                                            Datagram::DatagramType type,
+                                                                            QByteArray key) const {
+        return kj::joinPromises(KJ_MAP(id, balanceIds) {
+            return getDatagram(id, type, key).then([](Datagram::Reader datagram) -> kj::Maybe<Datagram::Reader> {
+                return datagram;
+            }, [](kj::Exception&& e) -> kj::Maybe<Datagram::Reader> {
+                // As in getContests, a transient error must not pass for a missing datagram
+                if (e.getType() != kj::Exception::Type::FAILED)
+                    kj::throwFatalException(kj::mv(e));
+                return nullptr;
+            });
+        });
+    }
 };
 
 #endif // BLOCKCHAINADAPTORINTERFACE_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LoopMonitor.hpp"
+
+#include <kj/debug.h>
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+
+namespace swv {
+
+namespace {
+// Turns longer than a frame at 60fps show up as jank in a UI thread
+const static uint64_t DEFAULT_TURN_ALERT_MICROS = 16000;
+const static uint64_t DEFAULT_LAG_ALERT_MICROS = 50000;
+const static uint64_t DEFAULT_TASK_SET_ALERT_SIZE = 1000;
+
+template <typename T>
+struct Registry {
+    std::mutex mutex;
+    std::set<T*> members;
+
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+    static void add(T* member) {
+        auto& registry = instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.members.insert(member);
+    }
+    static void remove(T* member) {
+        auto& registry = instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.members.erase(member);
+    }
+};
+} // anonymous namespace
+
+void Histogram::record(uint64_t sample) {
+    unsigned index = 0;
+    for (auto remaining = sample; remaining != 0 && index < BUCKETS - 1; remaining >>= 1)
+        ++index;
+    ++buckets[index];
+    ++samples;
+    total += sample;
+    largest = std::max(largest, sample);
+}
+
+void Histogram::fill(::Stats::Histogram::Builder histogram) const {
+    auto bucketList = histogram.initBuckets(BUCKETS);
+    for (unsigned i = 0; i < BUCKETS; ++i)
+        bucketList.set(i, buckets[i]);
+    histogram.setCount(samples);
+    histogram.setSum(total);
+    histogram.setMax(largest);
+}
+
+ThresholdAlert::ThresholdAlert(const char* subject, const char* measurement, uint64_t threshold)
+    : subject(subject),
+      measurement(measurement),
+      threshold(threshold) {}
+
+void ThresholdAlert::check(uint64_t sample) {
+    if (sample <= threshold)
+        return;
+
+    // When a loop falls behind, it does so on every turn; one line a second is plenty to tell
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastLogged < std::chrono::seconds(1)) {
+        ++suppressed;
+        return;
+    }
+    KJ_LOG(WARNING, "Threshold exceeded", subject, measurement, sample, threshold, suppressed);
+    lastLogged = now;
+    suppressed = 0;
+}
+
+LoopMonitor::LoopMonitor(const char* name)
+    : name(name),
+      turnThreshold(name, "turn microseconds", DEFAULT_TURN_ALERT_MICROS),
+      lagThreshold(name, "lag microseconds", DEFAULT_LAG_ALERT_MICROS) {
+    Registry<LoopMonitor>::add(this);
+}
+
+LoopMonitor::~LoopMonitor() {
+    Registry<LoopMonitor>::remove(this);
+}
+
+void LoopMonitor::recordTurn(uint64_t micros) {
+    turnHistogram.record(micros);
+    turnThreshold.check(micros);
+}
+
+void LoopMonitor::recordLag(uint64_t micros) {
+    lagHistogram.record(micros);
+    lagThreshold.check(micros);
+}
+
+std::vector<LoopMonitor::Report> LoopMonitor::report() {
+    auto& registry = Registry<LoopMonitor>::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<Report> reports;
+    for (auto monitor : registry.members)
+        reports.push_back({monitor->name, monitor->turnHistogram, monitor->lagHistogram});
+    return reports;
+}
+
+void LoopMonitor::fill(capnp::List<::Stats::LoopStats>::Builder loops, const std::vector<Report>& reports) {
+    for (unsigned i = 0; i < loops.size() && i < reports.size(); ++i) {
+        loops[i].setName(reports[i].name);
+        reports[i].turns.fill(loops[i].initTurnMicros());
+        reports[i].lag.fill(loops[i].initLagMicros());
+    }
+}
+
+MonitoredTaskSet::MonitoredTaskSet(kj::TaskSet::ErrorHandler& errorHandler, const char* name)
+    : name(name),
+      sizeThreshold(name, "pending tasks", DEFAULT_TASK_SET_ALERT_SIZE),
+      tasks(errorHandler) {
+    Registry<MonitoredTaskSet>::add(this);
+}
+
+MonitoredTaskSet::~MonitoredTaskSet() {
+    Registry<MonitoredTaskSet>::remove(this);
+}
+
+void MonitoredTaskSet::add(kj::Promise<void>&& promise) {
+    ++pending;
+    sizeHistogram.record(pending);
+    sizeThreshold.check(pending);
+    tasks.add(promise.attach(kj::defer([this] { --pending; })));
+}
+
+std::vector<MonitoredTaskSet::Report> MonitoredTaskSet::report() {
+    auto& registry = Registry<MonitoredTaskSet>::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<Report> reports;
+    for (auto taskSet : registry.members)
+        reports.push_back({taskSet->name, taskSet->pending, taskSet->sizeHistogram});
+    return reports;
+}
+
+void MonitoredTaskSet::fill(capnp::List<::Stats::TaskSetStats>::Builder taskSets,
+                            const std::vector<Report>& reports) {
+    for (unsigned i = 0; i < taskSets.size() && i < reports.size(); ++i) {
+        taskSets[i].setName(reports[i].name);
+        taskSets[i].setSize(reports[i].size);
+        reports[i].sizes.fill(taskSets[i].initSizes());
+    }
+}
+
+} // namespace swv
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOOPMONITOR_HPP
+#define LOOPMONITOR_HPP
+
+#include "shared_global.hpp"
+#include "stats.capnp.h"
+
+#include <kj/async.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace swv {
+
+/// A histogram with power-of-two buckets, as described by Stats.Histogram
+class SWVSHARED_EXPORT Histogram
+{
+public:
+    static const unsigned BUCKETS = 32;
+
+    void record(uint64_t sample);
+
+    uint64_t count() const {
+        return samples;
+    }
+    uint64_t sum() const {
+        return total;
+    }
+    uint64_t max() const {
+        return largest;
+    }
+    uint64_t bucket(unsigned index) const {
+        return buckets[index];
+    }
+
+    void fill(::Stats::Histogram::Builder histogram) const;
+
+private:
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t samples = 0;
+    uint64_t total = 0;
+    uint64_t largest = 0;
+};
+
+/// Logs a warning when a measurement exceeds a threshold, at most once per second
+class SWVSHARED_EXPORT ThresholdAlert
+{
+public:
+    ThresholdAlert(const char* subject, const char* measurement, uint64_t threshold);
+
+    void setThreshold(uint64_t threshold) {
+        this->threshold = threshold;
+    }
+    uint64_t getThreshold() const {
+        return threshold;
+    }
+
+    void check(uint64_t sample);
+
+private:
+    const char* subject;
+    const char* measurement;
+    uint64_t threshold;
+    std::chrono::steady_clock::time_point lastLogged;
+    uint64_t suppressed = 0;
+};
+
+/**
+ * @brief The LoopMonitor class measures how promptly a KJ event loop runs
+ *
+ * An event port owns a LoopMonitor and reports to it the duration of each turn it runs the loop for, and the lag from
+ * the loop becoming runnable until the turn began. Both are kept as histograms, and an alert is logged whenever either
+ * exceeds its threshold. Monitors register themselves for as long as they live, so @ref report can gather all of them.
+ *
+ * A monitor is not thread safe; report on it only from the thread running its loop.
+ */
+class SWVSHARED_EXPORT LoopMonitor
+{
+public:
+    /// @param name Name of the loop. It must outlive the monitor; use a string literal.
+    explicit LoopMonitor(const char* name);
+    ~LoopMonitor();
+    LoopMonitor(const LoopMonitor&) = delete;
+    LoopMonitor& operator=(const LoopMonitor&) = delete;
+
+    void recordTurn(uint64_t micros);
+    void recordLag(uint64_t micros);
+
+    const Histogram& turns() const {
+        return turnHistogram;
+    }
+    const Histogram& lag() const {
+        return lagHistogram;
+    }
+
+    ThresholdAlert& turnAlert() {
+        return turnThreshold;
+    }
+    ThresholdAlert& lagAlert() {
+        return lagThreshold;
+    }
+
+    struct Report {
+        const char* name;
+        Histogram turns;
+        Histogram lag;
+    };
+    /// @brief Get a copy of the histograms of all live monitors
+    static std::vector<Report> report();
+    static void fill(capnp::List<::Stats::LoopStats>::Builder loops, const std::vector<Report>& reports);
+
+private:
+    const char* name;
+    Histogram turnHistogram;
+    Histogram lagHistogram;
+    ThresholdAlert turnThreshold;
+    ThresholdAlert lagThreshold;
+};
+
+/**
+ * @brief The MonitoredTaskSet class is a kj::TaskSet which keeps count of its pending tasks
+ *
+ * kj::TaskSet does not expose its size, so a task set which grows without bound (because tasks are added faster than
+ * they complete, or some never complete) is otherwise invisible. Each add samples the size into a histogram, and logs
+ * an alert if it exceeds a threshold. Like LoopMonitor, monitored task sets register themselves for @ref report.
+ */
+class SWVSHARED_EXPORT MonitoredTaskSet
+{
+public:
+    /// @param name Name of the task set. It must outlive the task set; use a string literal.
+    MonitoredTaskSet(kj::TaskSet::ErrorHandler& errorHandler, const char* name);
+    ~MonitoredTaskSet();
+    MonitoredTaskSet(const MonitoredTaskSet&) = delete;
+    MonitoredTaskSet& operator=(const MonitoredTaskSet&) = delete;
+
+    void add(kj::Promise<void>&& promise);
+
+    uint64_t size() const {
+        return pending;
+    }
+    const Histogram& sizes() const {
+        return sizeHistogram;
+    }
+    ThresholdAlert& sizeAlert() {
+        return sizeThreshold;
+    }
+
+    struct Report {
+        const char* name;
+        uint64_t size;
+        Histogram sizes;
+    };
+    /// @brief Get a copy of the sizes of all live monitored task sets
+    static std::vector<Report> report();
+    static void fill(capnp::List<::Stats::TaskSetStats>::Builder taskSets, const std::vector<Report>& reports);
+
+private:
+    const char* name;
+    Histogram sizeHistogram;
+    ThresholdAlert sizeThreshold;
+    // Declared before tasks, as the tasks decrement it as they are destroyed
+    uint64_t pending = 0;
+    kj::TaskSet tasks;
+};
+
+} // namespace swv
+
+#endif // LOOPMONITOR_HPP
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ProcessStats.hpp"
+#include "LoopMonitor.hpp"
+#include "TrackingMessageBuilder.hpp"
+
+namespace swv {
+
+void fillProcessStats(::Stats::Builder stats) {
+    auto arenas = TrackingMessageBuilder::report();
+    TrackingMessageBuilder::fill(stats.initArenas(static_cast<unsigned>(arenas.size())), arenas);
+    auto loops = LoopMonitor::report();
+    LoopMonitor::fill(stats.initLoops(static_cast<unsigned>(loops.size())), loops);
+    auto taskSets = MonitoredTaskSet::report();
+    MonitoredTaskSet::fill(stats.initTaskSets(static_cast<unsigned>(taskSets.size())), taskSets);
+}
+
+} // namespace swv
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCESSSTATS_HPP
+#define PROCESSSTATS_HPP
+
+#include "shared_global.hpp"
+#include "stats.capnp.h"
+
+namespace swv {
+
+/// @brief Fill stats with the usage of this process's tracked arenas, monitored loops and monitored task sets
+/// @note Call this on the thread running the event loop, as it reads state belonging to that thread
+SWVSHARED_EXPORT void fillProcessStats(::Stats::Builder stats);
+
+} // namespace swv
+
+#endif // PROCESSSTATS_HPP
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StubCoinDetails.hpp"
+
+#include <chrono>
+
+namespace swv {
+
+void populateStubCoinDetails(::Backend::CoinDetails::Builder results, int32_t historyLength) {
+    results.setIconUrl("https://followmyvote.com/wp-content/uploads/2014/02/Follow-My-Vote-Logo.png");
+    results.setActiveContestCount(15);
+
+    if (historyLength <= 0) {
+        results.getVolumeHistory().setNoHistory();
+        return;
+    }
+
+    auto history = results.getVolumeHistory().initHistory();
+    // Get current time, rewound to the most recent hour
+    const int64_t millisPerHour = 1000 * 60 * 60;
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    history.setHistoryEndTimestamp(now / millisPerHour * millisPerHour);
+    auto histogram = history.initHistogram(historyLength);
+    for (int32_t i = 0; i < historyLength; ++i)
+        histogram.set(i, 1000000);
+}
+
+} // namespace swv
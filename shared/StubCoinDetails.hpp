@@ -0,0 +1,35 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STUBCOINDETAILS_HPP
+#define STUBCOINDETAILS_HPP
+
+#include "shared_global.hpp"
+#include "backend.capnp.h"
+
+#include <cstdint>
+
+namespace swv {
+
+/// @brief Fill results with the placeholder coin details served by the stub backends
+/// @param historyLength Number of hourly volume samples to include, ending at the most recent hour; none if not positive
+SWVSHARED_EXPORT void populateStubCoinDetails(::Backend::CoinDetails::Builder results, int32_t historyLength);
+
+} // namespace swv
+
+#endif // STUBCOINDETAILS_HPP
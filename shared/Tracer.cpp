@@ -0,0 +1,295 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Tracer.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+
+namespace swv {
+
+namespace {
+/// Spans kept per thread. Older spans are overwritten.
+const static size_t RING_CAPACITY = 4096;
+
+std::atomic<bool> enabled(qEnvironmentVariableIsSet("SWV_TRACE"));
+
+uint64_t randomId() {
+    std::random_device device;
+    std::mt19937_64 generator(device());
+    return generator();
+}
+
+uint64_t newId() {
+    // Start from a random point, so that IDs from different processes in the same trace don't collide
+    static std::atomic<uint64_t> nextId(randomId());
+    uint64_t id;
+    do {
+        id = nextId++;
+    } while (id == 0);
+    return id;
+}
+
+int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * A thread's ring buffer of spans. Only the owning thread writes to it. Each slot is guarded by a sequence number which
+ * is odd while the slot is being written, so a reader on another thread can copy a slot and detect whether the write
+ * raced with it, without the writer ever waiting.
+ */
+struct ThreadBuffer {
+    struct Slot {
+        std::atomic<uint32_t> sequence{0};
+        Tracer::Record record;
+    };
+
+    explicit ThreadBuffer(uint32_t threadId) : threadId(threadId) {}
+
+    void push(Tracer::Record record) {
+        record.threadId = threadId;
+        auto index = head.load(std::memory_order_relaxed);
+        auto& slot = slots[index % RING_CAPACITY];
+        slot.sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.sequence.fetch_add(1, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    void copyTo(std::vector<Tracer::Record>& records) const {
+        auto end = head.load(std::memory_order_acquire);
+        auto begin = end > RING_CAPACITY? end - RING_CAPACITY : 0;
+        for (auto index = begin; index < end; ++index) {
+            const auto& slot = slots[index % RING_CAPACITY];
+            auto sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence % 2)
+                continue;
+            auto record = slot.record;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+                records.push_back(record);
+        }
+    }
+
+    const uint32_t threadId;
+    std::atomic<uint64_t> head{0};
+    std::array<Slot, RING_CAPACITY> slots;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Buffers outlive their threads, so spans from finished threads can still be collected
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    uint32_t nextThreadId = 1;
+
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+};
+
+ThreadBuffer& threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        auto& registry = Registry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        buffer = std::make_shared<ThreadBuffer>(registry.nextThreadId++);
+        registry.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+QString hexId(uint64_t id) {
+    return QString::number(id, 16);
+}
+} // anonymous namespace
+
+Tracer::Span::Span(Tracer::Span&& other) noexcept
+    : record(other.record) {
+    other.record.spanId = 0;
+}
+
+Tracer::Span& Tracer::Span::operator=(Tracer::Span&& other) noexcept {
+    end();
+    record = other.record;
+    other.record.spanId = 0;
+    return *this;
+}
+
+Tracer::Span::~Span() {
+    end();
+}
+
+void Tracer::Span::end() {
+    if (!*this)
+        return;
+    record.durationMicros = nowMicros() - record.startMicros;
+    threadBuffer().push(record);
+    record.spanId = 0;
+}
+
+void Tracer::Span::propagate(::TraceContext::Builder context) const {
+    if (!*this)
+        return;
+    context.setTraceId(record.traceId);
+    context.setParentSpanId(record.spanId);
+}
+
+Tracer::Context Tracer::Span::context() const {
+    if (!*this)
+        return {};
+    return {record.traceId, record.spanId};
+}
+
+Tracer::Span Tracer::begin(const char* name) {
+    Span span;
+    if (!isEnabled())
+        return span;
+    span.record.traceId = newId();
+    span.record.spanId = newId();
+    span.record.name = name;
+    span.record.startMicros = nowMicros();
+    return span;
+}
+
+Tracer::Span Tracer::begin(const char* name, const Tracer::Span& parent) {
+    return begin(name, parent.context());
+}
+
+Tracer::Span Tracer::begin(const char* name, Tracer::Context parent) {
+    auto span = begin(name);
+    if (span && parent.traceId != 0) {
+        span.record.traceId = parent.traceId;
+        span.record.parentSpanId = parent.spanId;
+    }
+    return span;
+}
+
+Tracer::Span Tracer::begin(const char* name, ::TraceContext::Reader parent) {
+    auto span = begin(name);
+    if (span && parent.getTraceId() != 0) {
+        span.record.traceId = parent.getTraceId();
+        span.record.parentSpanId = parent.getParentSpanId();
+    }
+    return span;
+}
+
+bool Tracer::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setEnabled(bool enabled) {
+    swv::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::vector<Tracer::Record> Tracer::collect() {
+    std::vector<Record> records;
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& buffer : registry.buffers)
+        buffer->copyTo(records);
+    return records;
+}
+
+void Tracer::fill(capnp::List<::TraceSpan>::Builder spans, const std::vector<Record>& records) {
+    for (unsigned i = 0; i < spans.size() && i < records.size(); ++i) {
+        auto span = spans[i];
+        const auto& record = records[i];
+        span.setTraceId(record.traceId);
+        span.setSpanId(record.spanId);
+        span.setParentSpanId(record.parentSpanId);
+        span.setName(record.name);
+        span.setStartMicros(record.startMicros);
+        span.setDurationMicros(record.durationMicros);
+        span.setThreadId(record.threadId);
+    }
+}
+
+std::vector<Tracer::Record> Tracer::read(capnp::List<::TraceSpan>::Reader spans) {
+    std::vector<Record> records;
+    records.reserve(spans.size());
+    for (auto span : spans) {
+        Record record;
+        record.traceId = span.getTraceId();
+        record.spanId = span.getSpanId();
+        record.parentSpanId = span.getParentSpanId();
+        record.name = span.getName().cStr();
+        record.startMicros = span.getStartMicros();
+        record.durationMicros = span.getDurationMicros();
+        record.threadId = span.getThreadId();
+        records.push_back(record);
+    }
+    return records;
+}
+
+QByteArray Tracer::chromeTrace(const std::vector<Tracer::Process>& processes) {
+    struct Location {
+        int pid;
+        uint32_t tid;
+    };
+    std::map<uint64_t, Location> locations;
+    for (size_t p = 0; p < processes.size(); ++p)
+        for (const auto& span : processes[p].spans)
+            locations[span.spanId] = {int(p) + 1, span.threadId};
+
+    QJsonArray events;
+    for (size_t p = 0; p < processes.size(); ++p) {
+        int pid = int(p) + 1;
+        events.append(QJsonObject{{"name", "process_name"}, {"ph", "M"}, {"pid", pid},
+                                  {"args", QJsonObject{{"name", QString::fromUtf8(processes[p].name)}}}});
+
+        for (const auto& span : processes[p].spans) {
+            events.append(QJsonObject{
+                              {"name", QString::fromUtf8(span.name)}, {"cat", "swv"}, {"ph", "X"},
+                              {"ts", double(span.startMicros)}, {"dur", double(span.durationMicros)},
+                              {"pid", pid}, {"tid", double(span.threadId)},
+                              {"args", QJsonObject{{"traceId", hexId(span.traceId)}, {"spanId", hexId(span.spanId)},
+                                                   {"parentSpanId", hexId(span.parentSpanId)}}}
+                          });
+
+            // Draw an arrow from parents on other threads or in other processes, such as from an RPC's caller
+            auto parent = locations.find(span.parentSpanId);
+            if (span.parentSpanId == 0 || parent == locations.end() ||
+                    (parent->second.pid == pid && parent->second.tid == span.threadId))
+                continue;
+            events.append(QJsonObject{{"name", "call"}, {"cat", "swv"}, {"ph", "s"}, {"id", hexId(span.spanId)},
+                                      {"ts", double(span.startMicros)}, {"pid", parent->second.pid},
+                                      {"tid", double(parent->second.tid)}});
+            events.append(QJsonObject{{"name", "call"}, {"cat", "swv"}, {"ph", "f"}, {"bp", "e"},
+                                      {"id", hexId(span.spanId)}, {"ts", double(span.startMicros)},
+                                      {"pid", pid}, {"tid", double(span.threadId)}});
+        }
+    }
+
+    return QJsonDocument(QJsonObject{{"traceEvents", events}, {"displayTimeUnit", "ms"}}).toJson(QJsonDocument::Compact);
+}
+
+} // namespace swv
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include "shared_global.hpp"
+#include "trace.capnp.h"
+
+#include <QByteArray>
+
+#include <cstdint>
+#include <vector>
+
+namespace swv {
+
+/**
+ * @brief The Tracer class records timed spans of work, for export as a Chrome/Perfetto trace
+ *
+ * A span is begun with @ref begin and recorded when it ends, either explicitly or when it is destroyed. Spans are
+ * movable, so a span covering asynchronous work is simply attached to the work's promise. Each span belongs to a
+ * trace, and all spans begun with a parent share the parent's trace. To continue a trace in another process, pass
+ * the span's context along with the call (see TraceContext in trace.capnp) and begin the callee's spans from that.
+ *
+ * Completed spans are written to a fixed-size ring buffer belonging to the recording thread, so recording takes no
+ * locks and allocates nothing; the oldest spans are overwritten. @ref collect gathers the spans from all threads'
+ * buffers, and @ref chromeTrace formats them for chrome://tracing or ui.perfetto.dev.
+ *
+ * Tracing is disabled unless the SWV_TRACE environment variable is set, or it is enabled with @ref setEnabled. While
+ * it is disabled, spans are inert and cost only a check of a flag.
+ */
+class SWVSHARED_EXPORT Tracer
+{
+public:
+    /// A completed span. The name points to a string literal, or to a string owned by whoever provided the record.
+    struct Record {
+        uint64_t traceId = 0;
+        uint64_t spanId = 0;
+        uint64_t parentSpanId = 0;
+        const char* name = nullptr;
+        int64_t startMicros = 0;
+        int64_t durationMicros = 0;
+        uint32_t threadId = 0;
+    };
+
+    /// The IDs a child span takes from its parent. Unlike a span, it can be copied into work which outlives the parent.
+    struct Context {
+        uint64_t traceId = 0;
+        uint64_t spanId = 0;
+    };
+
+    class SWVSHARED_EXPORT Span {
+    public:
+        /// Create an inert span, which records nothing
+        Span() = default;
+        Span(Span&& other) noexcept;
+        Span& operator=(Span&& other) noexcept;
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+        ~Span();
+
+        /// Whether this span is recording, i.e. tracing was enabled when it began and it has not yet ended
+        explicit operator bool() const {
+            return record.spanId != 0;
+        }
+
+        /// @brief End the span and record it. Further calls do nothing.
+        void end();
+
+        /// @brief Write this span's context to a call's TraceContext, so the callee's spans become its children
+        void propagate(::TraceContext::Builder context) const;
+        /// @brief Get this span's context, to begin children from once it may have ended. Empty if this span is inert.
+        Context context() const;
+
+    private:
+        friend class Tracer;
+        Record record;
+    };
+
+    /// @brief Begin a span which starts a new trace. The name must outlive the tracer; use a string literal.
+    static Span begin(const char* name);
+    /// @brief Begin a child span of parent. If parent is inert, a new trace is started.
+    static Span begin(const char* name, const Span& parent);
+    /// @brief Begin a child span of the span the context was taken from. If the context is empty, a new trace is
+    /// started.
+    static Span begin(const char* name, Context parent);
+    /// @brief Begin a span as a child of a caller's span in another process. If the context is empty, a new trace is
+    /// started.
+    static Span begin(const char* name, ::TraceContext::Reader parent);
+
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    /// @brief Get a copy of the spans in all threads' ring buffers, oldest first within each thread
+    static std::vector<Record> collect();
+    /// @brief Copy records into a list of TraceSpans, such as for sending to another process
+    static void fill(capnp::List<::TraceSpan>::Builder spans, const std::vector<Record>& records);
+    /// @brief Read records from a list of TraceSpans. The records' names point into the list.
+    static std::vector<Record> read(capnp::List<::TraceSpan>::Reader spans);
+
+    /// One process's spans, for @ref chromeTrace
+    struct Process {
+        QByteArray name;
+        std::vector<Record> spans;
+    };
+    /// @brief Format the spans of one or more processes as Chrome trace event JSON
+    static QByteArray chromeTrace(const std::vector<Process>& processes);
+};
+
+} // namespace swv
+
+#endif // TRACER_HPP
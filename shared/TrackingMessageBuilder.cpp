@@ -0,0 +1,135 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrackingMessageBuilder.hpp"
+
+#include <capnp/any.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace swv {
+
+namespace {
+struct Registry {
+    std::mutex mutex;
+    std::set<TrackingMessageBuilder*> builders;
+
+    static Registry& instance() {
+        static Registry registry;
+        return registry;
+    }
+};
+} // anonymous namespace
+
+TrackingMessageBuilder::Usage& TrackingMessageBuilder::Usage::operator+=(const TrackingMessageBuilder::Usage& other) {
+    segments += other.segments;
+    bytesAllocated += other.bytesAllocated;
+    bytesUsed += other.bytesUsed;
+    bytesReachable += other.bytesReachable;
+    bytesOrphaned += other.bytesOrphaned;
+    return *this;
+}
+
+TrackingMessageBuilder::TrackingMessageBuilder(const char* arena, uint firstSegmentWords,
+                                               capnp::AllocationStrategy allocationStrategy)
+    : MallocMessageBuilder(firstSegmentWords, allocationStrategy),
+      arena(arena) {
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.builders.insert(this);
+}
+
+TrackingMessageBuilder::~TrackingMessageBuilder() noexcept {
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.builders.erase(this);
+}
+
+kj::ArrayPtr<capnp::word> TrackingMessageBuilder::allocateSegment(uint minimumSize) {
+    auto segment = MallocMessageBuilder::allocateSegment(minimumSize);
+    ++segments;
+    wordsAllocated += segment.size();
+    return segment;
+}
+
+void TrackingMessageBuilder::setReachableWords(std::function<uint64_t()> counter) {
+    reachableWords = kj::mv(counter);
+}
+
+TrackingMessageBuilder::Usage TrackingMessageBuilder::usage() {
+    Usage usage;
+    usage.segments = segments;
+    usage.bytesAllocated = wordsAllocated * sizeof(capnp::word);
+    // Don't make the arena allocate its first segment just to find it empty
+    if (segments == 0)
+        return usage;
+
+    uint64_t wordsUsed = 0;
+    for (auto segment : getSegmentsForOutput())
+        wordsUsed += segment.size();
+    uint64_t wordsReachable;
+    if (reachableWords)
+        wordsReachable = reachableWords();
+    else
+        // The root pointer, and whatever it points to
+        wordsReachable = 1 + getRoot<capnp::AnyPointer>().asReader().targetSize().wordCount;
+
+    usage.bytesUsed = wordsUsed * sizeof(capnp::word);
+    usage.bytesReachable = std::min(wordsReachable, wordsUsed) * sizeof(capnp::word);
+    usage.bytesOrphaned = usage.bytesUsed - usage.bytesReachable;
+    return usage;
+}
+
+std::vector<TrackingMessageBuilder::ArenaStats> TrackingMessageBuilder::report() {
+    std::map<std::string, ArenaStats> arenas;
+    auto& registry = Registry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto builder : registry.builders) {
+        auto& stats = arenas[builder->arena];
+        stats.name = builder->arena;
+        ++stats.messages;
+        stats.usage += builder->usage();
+    }
+
+    std::vector<ArenaStats> result;
+    result.reserve(arenas.size());
+    for (const auto& arena : arenas)
+        result.push_back(arena.second);
+    return result;
+}
+
+void TrackingMessageBuilder::fill(capnp::List<::Stats::ArenaStats>::Builder arenas,
+                                  const std::vector<TrackingMessageBuilder::ArenaStats>& stats) {
+    for (unsigned i = 0; i < arenas.size() && i < stats.size(); ++i) {
+        auto arena = arenas[i];
+        const auto& usage = stats[i].usage;
+        arena.setName(stats[i].name);
+        arena.setMessageCount(stats[i].messages);
+        arena.setSegmentCount(usage.segments);
+        arena.setBytesAllocated(usage.bytesAllocated);
+        arena.setBytesUsed(usage.bytesUsed);
+        arena.setBytesReachable(usage.bytesReachable);
+        arena.setBytesOrphaned(usage.bytesOrphaned);
+    }
+}
+
+} // namespace swv
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2015 Follow My Vote, Inc.
+ * This file is part of The Follow My Vote Stake-Weighted Voting Application ("SWV").
+ *
+ * SWV is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWV is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWV.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACKINGMESSAGEBUILDER_HPP
+#define TRACKINGMESSAGEBUILDER_HPP
+
+#include "shared_global.hpp"
+#include "stats.capnp.h"
+
+#include <capnp/message.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace swv {
+
+/**
+ * @brief The TrackingMessageBuilder class is a MallocMessageBuilder which accounts for the memory it uses
+ *
+ * Each tracking builder belongs to a named arena, such as the chain adaptor's message or all of the wrappers of one
+ * type, and registers itself for as long as it lives. @ref report totals the usage of the live builders in each arena,
+ * so the places a process's capnp memory goes can be inspected at runtime.
+ *
+ * A capnp message never reuses space, so data which is replaced or disowned and dropped stays allocated until the
+ * whole message is destroyed. The difference between the bytes a message has used and the bytes still reachable in it
+ * measures that waste. By default, the reachable bytes are those under the root; a builder whose owner keeps its data
+ * in orphans instead should say how to measure them with @ref setReachableWords.
+ *
+ * Measuring the reachable bytes walks the messages, so @ref usage and @ref report must be called on the thread which
+ * uses the messages, and they take time proportional to the messages' size.
+ */
+class SWVSHARED_EXPORT TrackingMessageBuilder : public capnp::MallocMessageBuilder
+{
+public:
+    struct SWVSHARED_EXPORT Usage {
+        uint64_t segments = 0;
+        uint64_t bytesAllocated = 0;
+        uint64_t bytesUsed = 0;
+        uint64_t bytesReachable = 0;
+        uint64_t bytesOrphaned = 0;
+
+        Usage& operator+=(const Usage& other);
+    };
+    /// The total usage of the live messages in one arena
+    struct ArenaStats {
+        const char* name = nullptr;
+        uint32_t messages = 0;
+        Usage usage;
+    };
+
+    /// @param arena Name of the arena the message belongs to. It must outlive the builder; use a string literal.
+    explicit TrackingMessageBuilder(const char* arena,
+                                    uint firstSegmentWords = capnp::SUGGESTED_FIRST_SEGMENT_WORDS,
+                                    capnp::AllocationStrategy allocationStrategy =
+            capnp::SUGGESTED_ALLOCATION_STRATEGY);
+    virtual ~TrackingMessageBuilder() noexcept;
+
+    virtual kj::ArrayPtr<capnp::word> allocateSegment(uint minimumSize) override;
+
+    /// @brief Set a function which counts the words of this message that are still in use, instead of those under
+    /// the root
+    void setReachableWords(std::function<uint64_t()> counter);
+
+    Usage usage();
+
+    /// @brief Get the usage of each arena which has live messages, sorted by name
+    static std::vector<ArenaStats> report();
+    /// @brief Copy a report into a list of ArenaStats, such as for sending to another process
+    static void fill(capnp::List<::Stats::ArenaStats>::Builder arenas, const std::vector<ArenaStats>& stats);
+
+private:
+    const char* arena;
+    uint64_t segments = 0;
+    uint64_t wordsAllocated = 0;
+    std::function<uint64_t()> reachableWords;
+};
+
+} // namespace swv
+
+#endif // TRACKINGMESSAGEBUILDER_HPP
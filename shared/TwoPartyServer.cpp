@@ -21,13 +21,14 @@
 // THE SOFTWARE.
 
 #include "TwoPartyServer.hpp"
+#include "Tracer.hpp"
 
 #include <kj/debug.h>
 
 namespace swv {
 
 TwoPartyServer::TwoPartyServer(capnp::Capability::Client bootstrapInterface)
-    : bootstrapInterface(kj::mv(bootstrapInterface)), tasks(*this) {}
+    : bootstrapInterface(kj::mv(bootstrapInterface)), tasks(*this, "TwoPartyServer") {}
 
 TwoPartyServer::~TwoPartyServer() {}
 
@@ -48,7 +49,7 @@ void TwoPartyServer::accept(kj::Own<kj::AsyncIoStream>&& connection) {
 
   // Run the connection until disconnect.
   auto promise = connectionState->network.onDisconnect();
-  tasks.add(promise.attach(kj::mv(connectionState)));
+  tasks.add(promise.attach(kj::mv(connectionState), Tracer::begin("TwoPartyServer::connection")));
 }
 
 kj::Promise<void> TwoPartyServer::listen(kj::Own<kj::ConnectionReceiver> listener) {
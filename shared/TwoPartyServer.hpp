@@ -23,11 +23,14 @@
 #ifndef TWOPARTYSERVER_HPP
 #define TWOPARTYSERVER_HPP
 
+#include "LoopMonitor.hpp"
+#include "shared_global.hpp"
+
 #include <capnp/rpc-twoparty.h>
 
 namespace swv {
 
-class TwoPartyServer : private kj::TaskSet::ErrorHandler
+class SWVSHARED_EXPORT TwoPartyServer : private kj::TaskSet::ErrorHandler
 {
     // Convenience class which implements a simple server which accepts connections on a listener
     // socket and serices them as two-party connections.
@@ -46,7 +49,7 @@ public:
 
 private:
     capnp::Capability::Client bootstrapInterface;
-    kj::TaskSet tasks;
+    MonitoredTaskSet tasks;
 
     struct AcceptedConnection;
 